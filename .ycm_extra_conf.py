@@ -45,7 +45,6 @@ flags = [
 
 '-Ilib/json-3.5.0/include',
 '-Ilib/curlpp-0.8.1/include',
-'-Ilib/libzippp-2.1-1.5.1/include',
 '-Ilib/boost-1.69.0/include',
 ]
 
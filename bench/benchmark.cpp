@@ -0,0 +1,136 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmark suite over local copy of profile (see generate.cpp).
+// Usage: benchmark <home> [--name <name>] [--runs <count>]
+//     [--session <dir>]
+// With "--session" update of profile is also measured by replay of
+// recorded session (without delays, unless INSTANALYZER_REPLAY_SPEED
+// is set). Results are printed to stdout in JSON, so they may be
+// compared between builds.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "comment.hpp"
+#include "data.hpp"
+#include "instanalyzer.hpp"
+#include "location.hpp"
+#include "profile.hpp"
+#include "term.hpp"
+
+using namespace nlohmann;
+using namespace std;
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] <<
+        " <home> [--name <name>] [--runs <count>] [--session <dir>]" << endl;
+    return EXIT_FAILURE;
+  }
+
+  string name = "synthetic", session;
+  unsigned int runs = 10;
+
+  for (int i = 2; i + 1 < argc; i += 2) {
+    if (string(argv[i]) == "--name") {
+      name = argv[i + 1];
+    } else if (string(argv[i]) == "--session") {
+      session = argv[i + 1];
+    } else if (string(argv[i]) == "--runs") {
+      runs = max(stoul(argv[i + 1]), 1ul);
+    } else {
+      cerr << "Invalid option: " << argv[i] << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Theme and geocoder are fixed, so nothing is asked and results don't
+  // depend on config. Theme is asked only for colored terminal.
+  setenv("HOME", argv[1], 1);
+  setenv("INSTANALYZER_MOCK_GEOCODER", "1", 1);
+  setenv("TERM", "dumb", 1);
+  Instanalyzer::init();
+  setenv("TERM", "xterm-256color", 1);
+  Term::init(true);
+
+  Location::set_geocoder(Location::GEOCODER_MOCK);
+  Instanalyzer::require(Instanalyzer::SUB_GEOCODER |
+      Instanalyzer::SUB_PROFILES);
+
+  if (!session.empty()) {
+    setenv("INSTANALYZER_REPLAY", session.c_str(), 1);
+    setenv("INSTANALYZER_REPLAY_SPEED", "0", 0);
+  }
+
+  const Profile profile(name);
+  vector<pair<string, function<void()>>> cases = {
+    {"load_posts", [&profile] { profile.get_posts(false); }},
+    {"get_comments", [&profile] {
+      Comment::get_comments(profile.get_posts());
+    }},
+    {"show_commentators", [&profile] { Comment::show_commentators(profile); }},
+    {"show_posts_top", [&profile] { Data::show_posts_top(profile); }},
+    {"show_tagged_profiles", [&profile] {
+      Data::show_tagged_profiles(profile);
+    }},
+    {"show_location_info", [&profile] { Data::show_location_info(profile); }}
+  };
+  if (!session.empty()) {
+    cases.emplace_back("update_replay", [&profile] { profile.update(); });
+  }
+
+  // Reports of cases aren't interesting here.
+  ofstream null("/dev/null");
+  streambuf* const cout_buf = cout.rdbuf(null.rdbuf());
+
+  json results = json::array();
+  for (const auto& c : cases) {
+    vector<double> times;
+
+    for (unsigned int i = 0; i < runs; ++i) {
+      const auto& begin = chrono::steady_clock::now();
+      c.second();
+      times.push_back(chrono::duration<double, milli>(
+          chrono::steady_clock::now() - begin).count());
+    }
+
+    sort(times.begin(), times.end());
+    results.push_back({
+      {"name", c.first}, {"runs", runs}, {"min_ms", times.front()},
+      {"median_ms", times.at(times.size() / 2)},
+      {"mean_ms", accumulate(times.cbegin(), times.cend(), 0.0) / runs}
+    });
+  }
+
+  cout.rdbuf(cout_buf);
+  cout << json({
+    {"profile", name}, {"posts", profile.get_posts().size()},
+    {"results", results}
+  }).dump(2) << endl;
+  return EXIT_SUCCESS;
+}
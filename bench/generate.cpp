@@ -0,0 +1,221 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Generator of synthetic profile in format of Instaloader, for benchmarks.
+// Usage: generate <home> [--name <name>] [--posts <count>]
+//     [--comments <per post>] [--tags <per post>] [--geotags <percents>]
+//     [--users <count>] [--seed <seed>] [--session <dir>] [--delay <ms>]
+// Profile is written to "<home>/.instanalyzer/profiles/<name>". With
+// "--session" the same profile is also written as recorded session of
+// Instaloader (see Modules::is_replay), which downloads post in "--delay".
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+
+#include "nlohmann/json.hpp"
+
+using namespace nlohmann;
+using namespace std;
+
+int main(int argc, char* argv[]) {
+  using namespace filesystem;
+
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] << " <home> [--name <name>] "
+        "[--posts <count>] [--comments <per post>] [--tags <per post>] "
+        "[--geotags <percents>] [--users <count>] [--seed <seed>] "
+        "[--session <dir>] [--delay <ms>]" << endl;
+    return EXIT_FAILURE;
+  }
+
+  map<string, unsigned long> options = {
+    {"--posts", 1000}, {"--comments", 20}, {"--tags", 2}, {"--geotags", 30},
+    {"--users", 1000}, {"--seed", 1}, {"--delay", 20}
+  };
+  string name = "synthetic", session;
+
+  for (int i = 2; i + 1 < argc; i += 2) {
+    if (string(argv[i]) == "--name") {
+      name = argv[i + 1];
+    } else if (string(argv[i]) == "--session") {
+      session = argv[i + 1];
+    } else if (options.count(argv[i]) != 0) {
+      options[argv[i]] = stoul(argv[i + 1]);
+    } else {
+      cerr << "Invalid option: " << argv[i] << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  const path& work_path = path(argv[1]) / ".instanalyzer";
+  const path& profile_path = work_path / "profiles" / name;
+  remove_all(profile_path);
+  create_directories(profile_path);
+
+  // Config without questions to user. Existing preferences are kept,
+  // only missing ones are added.
+  json config = json::object();
+  ifstream config_ifs(work_path / "config.json");
+  if (config_ifs.is_open()) {
+    try {
+      config_ifs >> config;
+    } catch (const exception&) {
+      cerr << "Config " << work_path / "config.json" << " is damaged!" << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  config_ifs.close();
+
+  const json& defaults = {
+    {"use_dark_theme", "1"},
+    {"last_cache_clean", to_string(time(nullptr))}
+  };
+  for (const auto& [key, value] : defaults.items()) {
+    if (!config.contains(key)) {
+      config[key] = value;
+    }
+  }
+  ofstream(work_path / "config.json") << config.dump(4) << endl;
+
+  mt19937_64 random(options["--seed"]);
+  const auto& uniform = [&random] (const unsigned long& t_max) {
+    return uniform_int_distribution<unsigned long>(0, t_max)(random);
+  };
+  const auto& get_user = [&] (const unsigned long& t_id) {
+    return json({{"id", to_string(1000000 + t_id)},
+        {"username", "user_" + to_string(t_id)},
+        {"full_name", "User " + to_string(t_id)},
+        {"is_verified", t_id % 50 == 0}});
+  };
+
+  // Recorded session contains the same files, except renamed on update
+  // and unused ones, and progress output of Instaloader.
+  ofstream events;
+  if (!session.empty()) {
+    remove_all(session);
+    create_directories(path(session) / "files");
+    events.open(path(session) / "session.ndjson");
+  }
+  const auto& record_file = [&] (const string& t_name,
+      const string& t_content, const unsigned long& t_delay = 0) {
+    if (events.is_open()) {
+      ofstream(path(session) / "files" / t_name) << t_content;
+      events << json({{"delay", t_delay}, {"file", t_name}}) << '\n';
+    }
+  };
+
+  const json& profile = {
+    {"node", {
+      {"id", "1"}, {"username", name}, {"full_name", "Synthetic profile"},
+      {"edge_follow", {{"count", 100}}},
+      {"edge_followed_by", {{"count", options["--users"]}}},
+      {"is_verified", false}, {"biography", "Generated for benchmarks."}
+    }},
+    {"instaloader", {{"node_type", "Profile"}}}
+  };
+  ofstream(profile_path / "profile.json") << profile << endl;
+
+  if (events.is_open()) {
+    events << json({{"out", name}}) << '\n';
+  }
+  record_file("id", "1\n");
+  record_file(name + "_1.json", profile.dump() + '\n');
+
+  // Posts are created every few hours from this time to the past.
+  time_t post_time = 1546300800;
+  unsigned long comment_id = 0;
+
+  for (unsigned long p = 0; p < options["--posts"]; ++p) {
+    post_time -= 3600 + uniform(24 * 3600);
+
+    json comments = json::array();
+    const unsigned long comments_count = uniform(options["--comments"] * 2);
+    for (unsigned long c = 0; c < comments_count; ++c) {
+      const unsigned long user = uniform(options["--users"] - 1);
+      comments.push_back({{"node", {
+        {"id", to_string(++comment_id)},
+        {"text", "Comment #tag" + to_string(uniform(50)) + " for @user_" +
+            to_string(uniform(options["--users"] - 1))},
+        {"created_at", post_time + uniform(7 * 24 * 3600)},
+        {"did_report_as_spam", uniform(100) == 0},
+        {"owner", get_user(user)},
+        {"edge_liked_by", {{"count", uniform(10)}}}
+      }}});
+    }
+
+    json tags = json::array();
+    const unsigned long tags_count = uniform(options["--tags"] * 2);
+    for (unsigned long t = 0; t < tags_count; ++t) {
+      tags.push_back({{"node", {
+        {"user", get_user(uniform(options["--users"] / 10))},
+        {"x", uniform(1000) / 1000.0}, {"y", uniform(1000) / 1000.0}
+      }}});
+    }
+
+    json node = {
+      {"__typename", uniform(4) == 0 ? "GraphSidecar" : "GraphImage"},
+      {"shortcode", "S" + to_string(p)},
+      {"taken_at_timestamp", post_time},
+      {"edge_media_preview_like", {{"count", uniform(5000)}}},
+      {"edge_media_to_comment", {{"count", comments_count},
+          {"edges", comments}}},
+      {"edge_media_to_tagged_user", {{"edges", tags}}},
+      {"edge_media_to_caption", {{"edges", {{{"node", {{"text",
+          "Post " + to_string(p) + " #daily #tag" + to_string(uniform(50)) +
+          " with @user_" + to_string(uniform(options["--users"] - 1))}}}}}}}}
+    };
+
+    if (uniform(99) < options["--geotags"]) {
+      node["location"] = {{"lat", uniform(180000) / 1000.0 - 90.0},
+          {"lng", uniform(360000) / 1000.0 - 180.0}};
+    }
+
+    char file_name[64];
+    strftime(file_name, sizeof(file_name), "%Y-%m-%d_%H-%M-%S_UTC.json",
+        gmtime(&post_time));
+    const string& post =
+        json({{"node", node}, {"instaloader", {{"node_type", "Post"}}}}).dump();
+    ofstream(profile_path / file_name) << post;
+
+    if (events.is_open()) {
+      char progress[64];
+      snprintf(progress, sizeof(progress), "[%4lu/%lu] S%lu json", p + 1,
+          options["--posts"], p);
+      events << json({{"delay", options["--delay"]}, {"out", progress}}) <<
+          '\n';
+      record_file(file_name, post);
+      record_file(path(file_name).stem().string() + "_comments.json",
+          comments.dump());
+    }
+  }
+
+  if (events.is_open()) {
+    events << json({{"exit", 0}}) << '\n';
+    cout << "Session of update recorded in " << session << endl;
+  }
+
+  cout << "Profile \"" << name << "\" with " << options["--posts"] <<
+      " posts generated in " << profile_path.string() << endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,222 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Microbenchmarks of hot helpers over local copy of profile
+// (see generate.cpp).
+// Usage: micro <home> [--name <name>] [--samples <count>]
+// Results are printed to stdout in JSON: time and heap allocations
+// per operation.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "comment.hpp"
+#include "graph.hpp"
+#include "instanalyzer.hpp"
+#include "memory.hpp"
+#include "profile.hpp"
+#include "term.hpp"
+#include "utils.hpp"
+
+using namespace nlohmann;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+  // Sample should be long enough for steady_clock resolution.
+  const nanoseconds MIN_SAMPLE_TIME = milliseconds(5);
+
+  // Results are accumulated here, so compiler can't drop calls.
+  volatile size_t sink;
+
+  struct Case {
+    string name;
+    function<size_t()> op;
+  };
+
+  nanoseconds run_sample(const Case& t_case, const unsigned long& t_ops) {
+    size_t result = 0;
+    const auto& begin = steady_clock::now();
+    for (unsigned long i = 0; i < t_ops; ++i) {
+      result += t_case.op();
+    }
+    const auto& time = steady_clock::now() - begin;
+    sink = sink + result;
+    return time;
+  }
+
+  json measure(const Case& t_case, const unsigned int& t_samples) {
+    // Count of operations in sample is doubled until it's long enough.
+    unsigned long ops = 1;
+    while (run_sample(t_case, ops) < MIN_SAMPLE_TIME) {
+      ops *= 2;
+    }
+
+    vector<double> times;
+    const Memory::Counters& start = Memory::get_counters();
+    for (unsigned int s = 0; s < t_samples; ++s) {
+      times.push_back(duration<double, nano>(
+          run_sample(t_case, ops)).count() / ops);
+    }
+    const Memory::Counters& end = Memory::get_counters();
+
+    const double mean =
+        accumulate(times.cbegin(), times.cend(), 0.0) / times.size();
+    double variance = 0;
+    for (const auto& t : times) {
+      variance += (t - mean) * (t - mean) / times.size();
+    }
+    sort(times.begin(), times.end());
+
+    const double total_ops = static_cast<double>(ops) * t_samples;
+    return {
+      {"name", t_case.name}, {"samples", t_samples}, {"ops_per_sample", ops},
+      {"min_ns", times.front()}, {"median_ns", times.at(times.size() / 2)},
+      {"mean_ns", mean}, {"stddev_ns", sqrt(variance)},
+      {"allocs_per_op", (end.allocs - start.allocs) / total_ops},
+      {"bytes_per_op", (end.bytes - start.bytes) / total_ops}
+    };
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] <<
+        " <home> [--name <name>] [--samples <count>]" << endl;
+    return EXIT_FAILURE;
+  }
+
+  string name = "synthetic";
+  unsigned int samples = 15;
+
+  for (int i = 2; i + 1 < argc; i += 2) {
+    if (string(argv[i]) == "--name") {
+      name = argv[i + 1];
+    } else if (string(argv[i]) == "--samples") {
+      samples = max(stoul(argv[i + 1]), 1ul);
+    } else {
+      cerr << "Invalid option: " << argv[i] << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Theme is fixed, so nothing is asked and results don't depend on
+  // config. Theme is asked only for colored terminal.
+  setenv("HOME", argv[1], 1);
+  setenv("TERM", "dumb", 1);
+  Instanalyzer::init();
+  setenv("TERM", "xterm-256color", 1);
+  Term::init(true);
+  Instanalyzer::require(Instanalyzer::SUB_PROFILES);
+
+  // Inputs are taken from corpus as they appear in reports.
+  const set<json>& posts = Profile(name).get_posts();
+  if (posts.empty()) {
+    cerr << "Profile \"" << name << "\" has no posts!" << endl;
+    return EXIT_FAILURE;
+  }
+
+  const set<Comment>& comments = Comment::get_comments(posts);
+  map<string, unsigned int> commentators;
+  for (const auto& c : comments) {
+    ++commentators[c.get_profile().get_name()];
+  }
+
+  vector<string> markups;
+  vector<Graph> graphs;
+  for (const auto& c : commentators) {
+    markups.push_back("Commentator: #{blue_out}" + c.first + "#{reset}; "
+        "comments: #{bold}" + to_string(c.second) + "#{reset}");
+
+    if (graphs.size() < 20) {
+      Graph graph;
+      graph.set_label('@' + c.first + " (" + to_string(c.second) +
+          " comments)");
+      graph.set_percents(static_cast<double>(c.second) / comments.size() *
+          100.0);
+      graph.set_colors(Graph::get_random_style());
+      graph.set_bold_text(false);
+      graphs.push_back(graph);
+    }
+  }
+
+  const vector<json> posts_list(posts.cbegin(), posts.cend());
+
+  // Profile without comments is measured on captions of posts.
+  const bool use_captions = markups.empty();
+  for (size_t i = 0; use_captions && i < posts_list.size(); ++i) {
+    const string& caption = posts_list[i].value(
+        "/node/edge_media_to_caption/edges/0/node/text"_json_pointer, "");
+    markups.push_back("Post: #{cream_out}" + to_string(i) + "#{reset}; "
+        "caption: #{bold}" + caption + "#{reset}");
+
+    if (graphs.size() < 20) {
+      Graph graph;
+      graph.set_label("Post " + to_string(i) + ": " + caption);
+      graph.set_percents(100.0 * (i + 1) / posts_list.size());
+      graph.set_colors(Graph::get_random_style());
+      graph.set_bold_text(false);
+      graphs.push_back(graph);
+    }
+  }
+  size_t markup_index = 0, post_index = 0;
+
+  const vector<Case> cases = {
+    {"Term::process_colors", [&] {
+      return Term::process_colors(
+          markups[markup_index++ % markups.size()]).size();
+    }},
+    {"Term::clear_line", [] { return Term::clear_line().size(); }},
+    {"Utils::has_json_node", [&] {
+      return static_cast<size_t>(Utils::has_json_node(
+          posts_list[post_index++ % posts_list.size()],
+          {"node", "edge_media_to_comment", "edges"}));
+    }},
+    {"Comment::get_comments", [&posts] {
+      return Comment::get_comments(posts).size();
+    }},
+    {"Graph::draw_graphs", [&graphs] {
+      ostringstream oss;
+      Graph::draw_graphs(oss, graphs);
+      return oss.str().size();
+    }}
+  };
+
+  Memory::set_enabled(true);
+  json results = json::array();
+  for (const auto& c : cases) {
+    results.push_back(measure(c, samples));
+  }
+  Memory::set_enabled(false);
+
+  cout << json({
+    {"profile", name}, {"posts", posts.size()},
+    {"comments", comments.size()}, {"results", results}
+  }).dump(2) << endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "batch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "instanalyzer.hpp"
+#include "modules.hpp"
+#include "profile.hpp"
+#include "reactor.hpp"
+#include "term.hpp"
+#include "worker.hpp"
+
+using namespace std;
+
+const unsigned int Batch::MAX_ATTEMPTS = 4;
+const unsigned int Batch::BACKOFF_SECONDS = 30;
+
+bool Batch::update_profiles(const string& t_list,
+    const unsigned int& t_jobs, const unsigned int& t_rate) {
+  using namespace chrono;
+  typedef steady_clock::time_point time_point;
+
+  struct Job {
+    string profile;
+    unsigned int attempt;
+    // Job can't be started before this time.
+    time_point ready_at;
+  };
+
+  deque<Job> jobs;
+  {
+    ifstream ifs;
+    if (t_list != "-") {
+      ifs.open(t_list);
+      if (ifs.fail()) {
+        Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
+            "List of profiles #{bold}" + t_list + "#{reset} didn't open!"));
+        return false;
+      }
+    }
+
+    istream& is = t_list == "-" ? cin : ifs;
+    string line;
+
+    while (getline(is, line)) {
+      const size_t start = line.find_first_not_of(" \t@"),
+          end = line.find_last_not_of(" \t\r");
+      if (start == string::npos || line[start] == '#') {
+        continue;
+      }
+      jobs.push_back({line.substr(start, end - start + 1), 1, {}});
+    }
+  }
+
+  if (jobs.empty()) {
+    Instanalyzer::msg(Instanalyzer::MSG_WARN, "No profiles to update!");
+    return true;
+  }
+
+  Instanalyzer::require(Instanalyzer::SUB_PROFILES | Instanalyzer::SUB_MODULES);
+  try {
+    Modules::get_interpreter_path();
+  } catch (const exception& e) {
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, e.what());
+    return false;
+  }
+
+  const size_t total = jobs.size();
+  const unsigned int max_running = max(1U, t_jobs);
+  const unsigned int rate = max(1U, t_rate);
+
+  cout << Term::process_colors("Updating #{blue_out}" + to_string(total) +
+      "#{reset} profiles (jobs: #{blue_out}" + to_string(max_running) +
+      "#{reset}, rate: #{blue_out}" + to_string(rate) +
+      "#{reset} per minute)...") << endl;
+
+  size_t running = 0, done = 0;
+  vector<pair<string, string>> failures;
+  // Start times of updates during last minute.
+  deque<time_point> starts;
+
+  const auto& print = [&done,&total] (const string& str) {
+    cout << Term::process_colors("[#{gray_out}" + to_string(done) + '/' +
+        to_string(total) + "#{reset}] ") + str << endl;
+  };
+
+  // All processes are supervised by Reactor in this thread,
+  // so callbacks don't need any synchronization.
+  while (!jobs.empty() || running != 0) {
+    const auto& now = steady_clock::now();
+    while (!starts.empty() && now - starts.front() >= minutes(1)) {
+      starts.pop_front();
+    }
+
+    for (auto j = jobs.begin(); j != jobs.end() &&
+        running < max_running && starts.size() < rate;) {
+      if (j->ready_at > now) {
+        ++j;
+        continue;
+      }
+
+      const Job job = *j;
+      j = jobs.erase(j);
+      starts.push_back(now);
+      ++running;
+
+      const auto& fdone = [&, job] (const Profile::UpdateStatus& t_status,
+          const string& t_error) {
+        --running;
+
+        if (t_status == Profile::UPD_RETRY && job.attempt < MAX_ATTEMPTS) {
+          const unsigned int delay = BACKOFF_SECONDS << (job.attempt - 1);
+          print(Term::process_colors("#{orange_out}@" + job.profile +
+              "#{reset}: connection retries exceeded, next attempt in #{bold}" +
+              to_string(delay) + "#{reset} s."));
+          jobs.push_back({job.profile, job.attempt + 1,
+              steady_clock::now() + seconds(delay)});
+          return;
+        }
+
+        ++done;
+        if (t_status == Profile::UPD_SUCCESS) {
+          print(Term::process_colors(
+              "#{green_out}@" + job.profile + "#{reset} updated."));
+        } else {
+          failures.emplace_back(job.profile, t_error);
+          print(Term::process_colors(
+              "#{red_out}@" + job.profile + "#{reset} failed."));
+        }
+      };
+
+      try {
+        Profile(job.profile).update_async(fdone);
+      } catch (const exception& e) {
+        fdone(Profile::UPD_FAILURE, e.what());
+      }
+    }
+
+    // Sleep until output of processes or until some job can be started.
+    int timeout_ms = -1;
+    if (!jobs.empty() && running < max_running) {
+      time_point wake_at = min_element(jobs.cbegin(), jobs.cend(),
+          [] (const Job& lhs, const Job& rhs) {
+            return lhs.ready_at < rhs.ready_at;
+          })->ready_at;
+      if (starts.size() >= rate) {
+        wake_at = max(wake_at, starts.front() + minutes(1));
+      }
+      timeout_ms = max(0L, static_cast<long>(duration_cast<milliseconds>(
+          wake_at - steady_clock::now()).count()) + 1);
+    }
+
+    try {
+      Reactor::run_once(timeout_ms);
+    } catch (const exception& e) {
+      Instanalyzer::msg(Instanalyzer::MSG_ERR, e.what());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  Worker::stop_pool();
+  cout << endl;
+  for (const auto& f : failures) {
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
+        "#{red_out}@" + f.first + "#{reset}: ") + (f.second.empty() ?
+        "unknown error." : f.second));
+  }
+  Instanalyzer::msg(failures.empty() ? Instanalyzer::MSG_INFO :
+      Instanalyzer::MSG_WARN, Term::process_colors("Batch update finished. "
+      "Updated: #{green_out}" + to_string(total - failures.size()) +
+      "#{reset}; failed: #{red_out}" + to_string(failures.size()) +
+      "#{reset}."));
+  return failures.empty();
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+class Batch {
+public:
+  inline static unsigned int get_default_jobs() { return 4; }
+  inline static unsigned int get_default_rate() { return 20; }
+
+  // Update profiles, listed in file (one name per line, "-" for stdin),
+  // using up to "jobs" Instaloader processes at the same time (workers
+  // with enabled worker mode, which are reused between profiles).
+  // All processes are supervised from calling thread.
+  // No more than "rate" updates (including retries) started per minute.
+  // Return false if update of some profile failed.
+  static bool update_profiles(const std::string& list,
+      const unsigned int& jobs = get_default_jobs(),
+      const unsigned int& rate = get_default_rate());
+
+private:
+  static const unsigned int MAX_ATTEMPTS;
+  // Delay before first retry, doubled on every next one.
+  static const unsigned int BACKOFF_SECONDS;
+};
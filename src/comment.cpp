@@ -18,6 +18,7 @@
 #include "comment.hpp"
 
 #include <algorithm>
+#include <cctype>
 #include <ctime>
 #include <iomanip>
 #include <iostream>
@@ -27,13 +28,17 @@
 
 #include "graph.hpp"
 #include "instanalyzer.hpp"
+#include "output.hpp"
 #include "term.hpp"
+#include "timings.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
 
 using namespace nlohmann;
 using namespace std;
 
 set<Comment> Comment::get_comments(const set<json>& t_posts) {
+  const Timings::Scope timing(Timings::PHASE_COMMENTS);
   set<Comment> comments;
 
   for (const auto& p : t_posts) {
@@ -79,6 +84,7 @@ set<Comment> Comment::get_comments(const set<json>& t_posts) {
 }
 
 void Comment::show_commentators(const Profile& t_profile) {
+  const Trace::Scope trace("Comment::show_commentators");
   t_profile.check();
 
   cout << "\rProcessing posts..." << flush;
@@ -100,6 +106,22 @@ void Comment::show_commentators(const Profile& t_profile) {
   };
   sort(commentators_sorted.begin(), commentators_sorted.end(), cmp);
 
+  if (Output::is_machine()) {
+    cout << Term::clear_line() << flush;
+    Output::begin_report("commentators",
+        {"username", "comments", "percents", "is_owner"});
+
+    for (const auto& c : commentators_sorted) {
+      if (!c.first.get_name().empty()) {
+        Output::write_record({c.first.get_name(), c.second,
+            static_cast<double>(c.second) / comments.size() * 100.0,
+            c.first.get_name() == t_profile.get_name()});
+      }
+    }
+    Output::end_report();
+    return;
+  }
+
   map<unsigned int, Graph::Colors> graphs_style;
   vector<Graph> graphs;
 
@@ -140,6 +162,7 @@ void Comment::show_commentators(const Profile& t_profile) {
 
 void Comment::show_commentator_info(const Profile& t_owner,
     const string& t_commentator) {
+  const Timings::Scope timing(Timings::PHASE_COMMENTATOR);
   t_owner.check();
 
   cout << "\n\rProcessing posts..." << flush;
@@ -187,6 +210,33 @@ void Comment::show_commentator_info(const Profile& t_owner,
 
 void Comment::print_comments(const set<Comment>& t_comments,
     const std::string& t_label) {
+  if (Output::is_machine()) {
+    string report = t_label.empty() ? "comments" : t_label;
+    for (auto& c : report) {
+      c = c == ' ' ? '_' : tolower(c);
+    }
+
+    Output::begin_report(report, {"id", "post_shortcode", "username", "text",
+        "likes", "timestamp", "is_spam"});
+    for (const auto& c : t_comments) {
+      Output::write_record({c.get_id(), c.get_post_shortcode(),
+          c.get_profile().get_name(), c.get_text(), c.get_likes(),
+          static_cast<long long>(c.get_creation_time()), c.is_spam()});
+    }
+    Output::end_report();
+    return;
+  }
+
+  static constexpr Term::Markup spam_mark("  #{bold}#{red_out}*#{reset}"
+      "#{gray_out} ");
+  static constexpr Term::Markup comment_mark("  #{bold}#{green_out}-#{reset}"
+      "#{gray_out} ");
+  static constexpr Term::Markup shortcode_mark(", #{cream_out}");
+
+  // Render markup once, text of comments is appended as is.
+  const string& spam_prefix = spam_mark.str(),
+      comment_prefix = comment_mark.str(),
+      shortcode_prefix = shortcode_mark.str();
   ostringstream ss;
 
   for (const auto& c : t_comments) {
@@ -203,15 +253,10 @@ void Comment::print_comments(const set<Comment>& t_comments,
     const string& text_likes = to_string(comment_likes) + " like" +
         (comment_likes == 1 ? "" : "s");
 
-    const string& additional_info = '(' + date.str() +
-        (comment_likes == 0 ? "" : ", " + text_likes) +
-        ", #{cream_out}" + c.get_post_shortcode() + "#{reset})";
-
-    const string& text = Term::process_colors(string("  #{bold}") + (c.is_spam() ?
-        "#{red_out}*" : "#{green_out}-") + string("#{reset}#{gray_out} ") +
-        c.get_text() + " #{reset}" + additional_info);
-
-    ss << text << endl;
+    ss << (c.is_spam() ? spam_prefix : comment_prefix) << c.get_text() << ' ' <<
+        Term::reset() << '(' << date.str() <<
+        (comment_likes == 0 ? "" : ", " + text_likes) << shortcode_prefix <<
+        c.get_post_shortcode() << Term::reset() << ')' << endl;
   }
 
   if (!ss.str().empty()) {
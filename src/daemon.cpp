@@ -0,0 +1,370 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "daemon.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+#include "nlohmann/json.hpp"
+
+#include "data.hpp"
+#include "params.hpp"
+#include "term.hpp"
+#include "trace.hpp"
+#include "worker.hpp"
+
+using namespace nlohmann;
+using namespace std;
+
+const int Daemon::REAP_INTERVAL_MS = 50;
+const size_t Daemon::LOAD_STEP_POSTS = 200;
+map<string, Data::PostsLoader> Daemon::m_loads;
+
+void Daemon::run() {
+  using namespace filesystem;
+
+  const int running_fd = connect_socket();
+  if (running_fd != -1) {
+    close(running_fd);
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, "Daemon already running!");
+    exit(EXIT_FAILURE);
+  }
+
+  Instanalyzer::require(Instanalyzer::SUB_CACHE | Instanalyzer::SUB_PROFILES);
+  // Daemon has memory for posts of any size, they are parsed only once.
+  Profile::set_cache_unlimited(true);
+  // Worker is started once and shared by processes of requests.
+  if (Worker::is_enabled()) {
+    try {
+      Worker::start();
+    } catch (const exception& e) {
+      Instanalyzer::msg(Instanalyzer::MSG_ERR, e.what());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  error_code e;
+  remove(get_socket_path(), e);
+
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, get_socket_path().c_str(), sizeof(addr.sun_path) - 1);
+
+  const int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd == -1 ||
+      bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      listen(listen_fd, SOMAXCONN) != 0) {
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
+        "Can't listen socket: \"#{gray_out}" + string(strerror(errno)) +
+        "#{reset}\"."));
+    exit(EXIT_FAILURE);
+  }
+
+  Instanalyzer::msg(Instanalyzer::MSG_INFO, Term::process_colors(
+      "Daemon is listening on #{gray_out}" + string(get_socket_path()) +
+      "#{reset}."));
+
+  // Connections of clients, which requests are running.
+  map<pid_t, int> requests;
+
+  for (;;) {
+    // Clients are only checked while profiles are loading.
+    const bool is_loading = load_step();
+    pollfd pfd = {listen_fd, POLLIN, 0};
+    const int ready = poll(&pfd, 1,
+        is_loading ? 0 : requests.empty() ? -1 : REAP_INTERVAL_MS);
+
+    if (ready == -1 && errno != EINTR) {
+      Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
+          "Can't wait for clients: \"#{gray_out}" + string(strerror(errno)) +
+          "#{reset}\"."));
+      exit(EXIT_FAILURE);
+    }
+
+    if (ready > 0) {
+      const int client_fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+      string request;
+      int fds[3] = {-1, -1, -1};
+
+      if (client_fd != -1 && receive_request(client_fd, request, fds)) {
+        const pid_t pid = serve(listen_fd, request, fds);
+        if (pid != -1) {
+          requests[pid] = client_fd;
+        } else {
+          close(client_fd);
+        }
+      } else if (client_fd != -1) {
+        close(client_fd);
+      }
+
+      for (const auto& fd : fds) {
+        if (fd != -1) {
+          close(fd);
+        }
+      }
+    }
+
+    // Only processes of requests are waited, because others (e.g. worker)
+    // are waited by their owners.
+    for (auto r = requests.begin(); r != requests.end();) {
+      int status = 0;
+      if (waitpid(r->first, &status, WNOHANG) <= 0) {
+        ++r;
+        continue;
+      }
+
+      const int code = WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+      const string& response = to_string(code) + '\n';
+      send(r->second, response.data(), response.size(), MSG_NOSIGNAL);
+      close(r->second);
+      r = requests.erase(r);
+    }
+  }
+}
+
+int Daemon::forward(const vector<string>& t_params) {
+  const int fd = connect_socket();
+  if (fd == -1) {
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
+        "Daemon isn't running! Start it with #{bold}--daemon#{reset}."));
+    return EXIT_FAILURE;
+  }
+
+  json env = json::object();
+  for (char** e = environ; *e != nullptr; ++e) {
+    const string var = *e;
+    const size_t pos = var.find('=');
+    if (pos != string::npos && is_client_env(var.substr(0, pos))) {
+      env[var.substr(0, pos)] = var.substr(pos + 1);
+    }
+  }
+
+  const char* term = getenv("TERM");
+  const string& request = json({
+    {"params", t_params},
+    {"cwd", filesystem::current_path().string()},
+    {"term", term == nullptr ? "" : term},
+    {"env", env}
+  }).dump() + '\n';
+
+  // Standard streams are attached to first part of request.
+  int fds[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+  char control[CMSG_SPACE(sizeof(fds))] = {};
+  iovec iov = {const_cast<char*>(request.data()), request.size()};
+
+  msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+  while (sent > 0 && static_cast<size_t>(sent) < request.size()) {
+    const ssize_t n = send(fd, request.data() + sent, request.size() - sent,
+        MSG_NOSIGNAL);
+    sent = n > 0 ? sent + n : n;
+  }
+
+  // Exit code is sent as single line. Connection isn't waited to close,
+  // because processes of other requests may hold it too.
+  string response;
+  char buffer[64];
+  while (sent > 0 && response.find('\n') == string::npos) {
+    const ssize_t n = read(fd, buffer, sizeof(buffer));
+    if (n > 0) {
+      response.append(buffer, n);
+    } else if (n == 0 || errno != EINTR) {
+      break;
+    }
+  }
+  close(fd);
+
+  try {
+    return stoi(response);
+  } catch (const exception&) {
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, "Daemon didn't finish request!");
+    return EXIT_FAILURE;
+  }
+}
+
+int Daemon::connect_socket() {
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, get_socket_path().c_str(), sizeof(addr.sun_path) - 1);
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd != -1 &&
+      connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool Daemon::receive_request(const int& t_fd, string& t_request,
+    int t_fds[3]) {
+  char buffer[4096];
+  char control[CMSG_SPACE(sizeof(int) * 3)] = {};
+  iovec iov = {buffer, sizeof(buffer)};
+
+  msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t n = recvmsg(t_fd, &msg, MSG_CMSG_CLOEXEC);
+  if (n <= 0) {
+    return false;
+  }
+
+  for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c != nullptr;
+      c = CMSG_NXTHDR(&msg, c)) {
+    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS &&
+        c->cmsg_len == CMSG_LEN(sizeof(int) * 3)) {
+      memcpy(t_fds, CMSG_DATA(c), sizeof(int) * 3);
+    }
+  }
+
+  t_request.assign(buffer, n);
+  while (t_request.back() != '\n') {
+    n = read(t_fd, buffer, sizeof(buffer));
+    if (n == -1 && errno == EINTR) {
+      continue;
+    } else if (n <= 0) {
+      return false;
+    }
+    t_request.append(buffer, n);
+  }
+  return t_fds[0] != -1;
+}
+
+pid_t Daemon::serve(const int& t_listen_fd, const string& t_request,
+    const int t_fds[3]) {
+  vector<string> params;
+  string cwd, term;
+  json env;
+
+  try {
+    const json& request = json::parse(t_request);
+    params = request.at("params").get<vector<string>>();
+    cwd = request.value("cwd", "");
+    term = request.value("term", "");
+    env = request.value("env", json::object());
+  } catch (const exception&) {
+    return -1;
+  }
+
+  // Profile and its indexes are loaded in daemon, so they stay in memory
+  // for next requests. Until then, request loads profile by itself.
+  const string& profile = Params::find_profile(params);
+  if (!profile.empty()) {
+    load_profile(profile);
+  }
+
+  cout << flush;
+  const pid_t pid = fork();
+  if (pid != 0) {
+    return pid;
+  }
+
+  Trace::on_fork();
+  close(t_listen_fd);
+  for (int i = 0; i < 3; ++i) {
+    dup2(t_fds[i], i);
+  }
+
+  if (chdir(cwd.c_str()) != 0) {
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
+        "Can't change directory to #{gray_out}" + cwd + "#{reset}!"));
+    exit(EXIT_FAILURE);
+  }
+  setenv("TERM", term.c_str(), true);
+  set_client_env(env);
+  Term::init(Term::is_dark_theme());
+
+  Params::process_params(params);
+  cout << flush;
+  exit(EXIT_SUCCESS);
+}
+
+void Daemon::load_profile(const string& t_name) {
+  const Profile profile(t_name);
+  if (m_loads.count(t_name) == 0 && !Data::has_posts_index(profile)) {
+    m_loads.emplace(t_name, Data::PostsLoader(profile));
+  }
+}
+
+bool Daemon::load_step() {
+  for (auto l = m_loads.begin(); l != m_loads.end();) {
+    try {
+      if (!l->second.step(LOAD_STEP_POSTS)) {
+        ++l;
+        continue;
+      }
+    } catch (const exception& e) {
+      Instanalyzer::msg(Instanalyzer::MSG_WARN, Term::process_colors(
+          "Can't load profile #{gray_out}" + l->first + "#{reset}: \"" +
+          e.what() + "\"."));
+    }
+    l = m_loads.erase(l);
+  }
+  return !m_loads.empty();
+}
+
+void Daemon::set_client_env(const json& t_env) {
+  vector<string> names;
+  for (char** e = environ; *e != nullptr; ++e) {
+    const string var = *e;
+    const size_t pos = var.find('=');
+    if (pos != string::npos && is_client_env(var.substr(0, pos))) {
+      names.push_back(var.substr(0, pos));
+    }
+  }
+  for (const auto& n : names) {
+    unsetenv(n.c_str());
+  }
+
+  for (const auto& [name, value] : t_env.items()) {
+    if (is_client_env(name) && value.is_string()) {
+      setenv(name.c_str(), value.get<string>().c_str(), true);
+    }
+  }
+  tzset();
+}
+
+bool Daemon::is_client_env(const string& t_name) {
+  return t_name == "TZ" || t_name.rfind("INSTANALYZER_", 0) == 0;
+}
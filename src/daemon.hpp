@@ -0,0 +1,74 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "nlohmann/json.hpp"
+
+#include "data.hpp"
+#include "instanalyzer.hpp"
+
+class Daemon {
+public:
+  // Serve requests of clients until terminated. Every request is
+  // handled by forked process, which inherits profiles loaded before
+  // by daemon, so repeated requests don't parse them again. Profiles are
+  // loaded by parts between requests, so large one doesn't delay others.
+  // Daemon doesn't start threads, so forked processes can't inherit
+  // locks held by them.
+  // With enabled worker mode, one Instaloader worker is shared by all
+  // requests.
+  static void run();
+  // Send parameters to daemon and wait for result. Standard streams of
+  // client are passed to daemon, so output is written to them directly.
+  // Time zone and INSTANALYZER_* variables of client are passed too.
+  // Return exit code of request.
+  static int forward(const std::vector<std::string>& params);
+
+  inline static std::filesystem::path get_socket_path() {
+    return Instanalyzer::get_work_path() / "daemon.sock";
+  }
+
+private:
+  static int connect_socket();
+  // Receive request and standard streams of client.
+  static bool receive_request(const int& fd, std::string& request, int fds[3]);
+  // Start process, which handles request. Return its pid or -1.
+  static pid_t serve(const int& listen_fd, const std::string& request,
+      const int fds[3]);
+  // Start loading of profile, unless it's loaded already.
+  static void load_profile(const std::string& name);
+  // Load next part of every loading profile. Return whether some are
+  // still loading.
+  static bool load_step();
+  // Replace environment variables, which are passed by client.
+  static void set_client_env(const nlohmann::json& env);
+  static bool is_client_env(const std::string& name);
+
+  // Interval of checking finished requests while some are running.
+  static const int REAP_INTERVAL_MS;
+  // Number of posts, which are loaded between checks of clients.
+  static const std::size_t LOAD_STEP_POSTS;
+  static std::map<std::string, Data::PostsLoader> m_loads;
+};
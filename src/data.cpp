@@ -18,90 +18,48 @@
 #include "data.hpp"
 
 #include <algorithm>
+#include <cctype>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <numeric>
 #include <vector>
 
 #include "graph.hpp"
 #include "instanalyzer.hpp"
+#include "output.hpp"
 #include "post.hpp"
+#include "timings.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
 
 using namespace std;
 using namespace nlohmann;
 
-const vector<pair<string, Data::val_parser>> Data::m_profile_data = {
-  {"Username", [] (const json& j) -> string {
-    try {
-      const string& v = j.at("node").at("username");
-      return v.empty() ? "" : "#{red_out}" + v + "#{reset}";
-    } catch (const json::exception&) { return ""; }
-  }},
-  {"Full name", [] (const json& j) -> string {
-    try {
-      const string& v = j.at("node").at("full_name");
-      return v.empty() ? "" : "#{red_out}" + v + "#{reset}";
-    } catch (const json::exception&) { return ""; }
-  }},
-  {"Following", [] (const json& j) -> string {
-    try {
-      const int v = j.at("node").at("edge_follow").at("count");
-      return "#{red_out}" + to_string(v) + "#{reset}";
-    } catch (const json::exception&) { return ""; }
-  }},
-  {"Followers", [] (const json& j) -> string {
-    try {
-      const int v = j.at("node").at("edge_followed_by").at("count");
-      return "#{red_out}" + to_string(v) + "#{reset}";
-    } catch (const json::exception&) { return ""; }
-  }},
-  {"Business category", [] (const json& j) -> string {
-    try {
-      const string& v = j.at("node").at("business_category_name");
-      return v.empty() ? "" : "#{blue_out}" + v + "#{reset}";
-    } catch (const json::exception&) { return ""; }
-  }},
-  {"Business email", [] (const json& j) -> string {
-    try {
-      const string& v = j.at("node").at("business_email");
-      return v.empty() ? "" : "#{blue_out}" + v + "#{reset}";
-    } catch (const json::exception&) { return ""; }
-  }},
-  {"Business phone", [] (const json& j) -> string {
-    try {
-      const string& v = j.at("node").at("business_phone_number");
-      return v.empty() ? "" : "#{blue_out}" + v + "#{reset}";
-    } catch (const json::exception&) { return ""; }
-  }},
-  {"Facebook page", [] (const json& j) -> string {
-    try {
-      const string& v = j.at("node").at("connected_fb_page");
-      return v.empty() ? "" : "#{yellow_out}" + v + "#{reset}";
-    } catch (const json::exception&) { return ""; }
-  }},
-  {"External URL", [] (const json& j) -> string {
-    try {
-      const string& v = j.at("node").at("external_url");
-      return v.empty() ? "" : "#{yellow_out}" + v + "#{reset}";
-    } catch (const json::exception&) { return ""; }
-  }},
-  {"Verified", [] (const json& j) -> string {
-    try {
-      const bool v = j.at("node").at("is_verified");
-      return "#{cream_out}" + string(v ? "yes" : "no") + "#{reset}";
-    } catch (const json::exception&) { return ""; }
-  }},
-  {"Biography", [] (const json& j) -> string {
-    try {
-      const string& v = j.at("node").at("biography");
-      return v.empty() ? "" : "#{cream_out}" + v + "#{reset}";
-    } catch (const json::exception&) { return ""; }
-  }}
+const unsigned int Data::ROLLING_WINDOW = 10;
+const unsigned int Data::SHOWN_PERIODS = 12;
+const unsigned int Data::HEATMAP_SIZE = 16;
+const unsigned int Data::SHOWN_HEATMAPS = 3;
+
+map<string, Data::PostsIndex> Data::m_posts_indexes;
+
+const vector<Data::ProfileField> Data::m_profile_data = {
+  {"Username", {"username"}, "red_out"},
+  {"Full name", {"full_name"}, "red_out"},
+  {"Following", {"edge_follow", "count"}, "red_out"},
+  {"Followers", {"edge_followed_by", "count"}, "red_out"},
+  {"Business category", {"business_category_name"}, "blue_out"},
+  {"Business email", {"business_email"}, "blue_out"},
+  {"Business phone", {"business_phone_number"}, "blue_out"},
+  {"Facebook page", {"connected_fb_page"}, "yellow_out"},
+  {"External URL", {"external_url"}, "yellow_out"},
+  {"Verified", {"is_verified"}, "cream_out"},
+  {"Biography", {"biography"}, "cream_out"}
 };
 
 void Data::show_profile_info(const Profile& t_profile) {
+  const Trace::Scope trace("Data::show_profile_info");
   t_profile.check();
 
   ifstream ifs(
@@ -114,18 +72,50 @@ void Data::show_profile_info(const Profile& t_profile) {
 
   json j = json::parse(ifs);
   ifs.close();
-  bool have_some_info = false;
 
-  for (const auto& i : m_profile_data) {
-    have_some_info = true;
-    const string& val = i.second(j);
+  if (Output::is_machine()) {
+    vector<string> columns;
+    vector<Output::Value> values;
 
-    if (val.empty()) {
+    for (const auto& f : m_profile_data) {
+      string column = f.name;
+      for (auto& c : column) {
+        c = c == ' ' ? '_' : tolower(c);
+      }
+      columns.push_back(column);
+
+      // Numbers and flags keep their types, absent values are empty.
+      const json& v = get_profile_value(j, f);
+      if (v.is_boolean()) {
+        values.emplace_back(v.get<bool>());
+      } else if (v.is_number_integer()) {
+        values.emplace_back(v.get<long long>());
+      } else if (v.is_number()) {
+        values.emplace_back(v.get<double>());
+      } else {
+        values.emplace_back(v.is_string() ? v.get<string>() : "");
+      }
+    }
+
+    Output::begin_report("profile", columns);
+    Output::write_record(values);
+    Output::end_report();
+    return;
+  }
+
+  bool have_some_info = false;
+
+  for (const auto& f : m_profile_data) {
+    const json& v = get_profile_value(j, f);
+    if (v.is_null()) {
       continue;
-    } else {
-      cout << Term::process_colors("#{gray_out}" + i.first + ":#{reset} ") +
-          Term::process_colors(val) << endl;
     }
+
+    have_some_info = true;
+    const string& val = v.is_boolean() ? (v.get<bool>() ? "yes" : "no") :
+        v.is_string() ? v.get<string>() : v.dump();
+    cout << Term::process_colors("#{gray_out}" + f.name + ":#{reset} #{" +
+        f.color + '}') + val + Term::reset() << endl;
   }
 
   if (!have_some_info) {
@@ -133,8 +123,30 @@ void Data::show_profile_info(const Profile& t_profile) {
   }
 }
 
+json Data::get_profile_value(const json& t_profile,
+    const ProfileField& t_field) {
+  if (!t_profile.is_object() || !t_profile.contains("node")) {
+    return nullptr;
+  }
+  const json* value = &t_profile["node"];
+
+  for (const auto& k : t_field.path) {
+    if (!value->is_object() || !value->contains(k)) {
+      return nullptr;
+    }
+    value = &(*value)[k];
+  }
+
+  if ((value->is_string() && value->get<string>().empty()) ||
+      (!value->is_string() && !value->is_number() && !value->is_boolean())) {
+    return nullptr;
+  }
+  return *value;
+}
+
 void Data::show_location_info(
     const Profile& t_profile, const unsigned int& t_radius) {
+  const Trace::Scope trace("Data::show_location_info");
   t_profile.check();
 
   const set<Location::Place> places = Location::get_common_places(
@@ -143,52 +155,43 @@ void Data::show_location_info(
     return;
   }
 
-  bool at_least_one_group_printed = false;
-  Location::Place place;
-
-  const vector<LocationGroup> groups = {
-    {"Country", {&place.country}},
-    {"Region", {&place.state, &place.country}},
-    {"District", {&place.county, &place.state, &place.country}},
-    {"City", {&place.city, &place.county, &place.state, &place.country}}
+  static const vector<LocationGroup> groups = {
+    {"Country", &Location::Place::country},
+    {"Region", &Location::Place::state},
+    {"District", &Location::Place::county},
+    {"City", &Location::Place::city}
   };
 
-  for (const auto& g : groups) {
-    // Map of labels and repeat count.
-    map<string, unsigned int> group_places;
-    size_t places_count = places.size();
-
-    for (const auto& p : places) {
-      place = p;
-      string label;
-      size_t i = 0, count = g.address_tree.size();
-
-      for (const auto& a : g.address_tree) {
-        ++i;
-        if (a->empty()) {
-          if (i == 1) {
-            break;
-          } else {
-            continue;
-          }
-        }
+  LocationTree tree(groups);
+  for (const auto& p : places) {
+    tree.insert(p);
+  }
 
-        label += *a;
-        if (i != count) {
-          label += ", ";
-        }
-      }
+  bool at_least_one_group_printed = false;
+  if (Output::is_machine()) {
+    Output::begin_report("location", {"level", "place", "count", "percents"});
+  }
 
-      if (label.empty()) {
-        --places_count;
-        continue;
-      } else {
-        ++group_places[label];
+  for (size_t l = 0; l < groups.size(); ++l) {
+    const auto& g = groups[l];
+    const unsigned int places_count = tree.known[l];
+
+    // Pairs of node index and repeat count.
+    vector<pair<size_t, unsigned int>> group_places;
+    for (const auto& n : tree.levels[l]) {
+      if (tree.nodes[n].name != 0) {
+        group_places.emplace_back(n, tree.nodes[n].count);
       }
     }
 
     if (group_places.empty()) {
       continue;
+    } else if (Output::is_machine()) {
+      for (const auto& p : group_places) {
+        Output::write_record({g.name, tree.get_label(p.first), p.second,
+            static_cast<double>(p.second) / places_count * 100.0});
+      }
+      continue;
     }
 
     cout << Term::process_colors("\n#{bold}> " + g.name) << flush;
@@ -201,18 +204,16 @@ void Data::show_location_info(
     cout << Term::reset() << endl;
 
     Graph::Colors colors = Graph::get_random_style();
-    const auto& cmp = [] (const pair<string, unsigned int>& lhs,
-        const pair<string, unsigned int>& rhs) {
+    const auto& cmp = [] (const pair<size_t, unsigned int>& lhs,
+        const pair<size_t, unsigned int>& rhs) {
       return lhs.second > rhs.second;
     };
-    vector<pair<string, unsigned int>>
-        places_sorted(group_places.cbegin(), group_places.cend());
-    sort(places_sorted.begin(), places_sorted.end(), cmp);
+    stable_sort(group_places.begin(), group_places.end(), cmp);
 
     vector<Graph> graphs;
-    for (const auto& p : places_sorted) {
+    for (const auto& p : group_places) {
       Graph graph;
-      graph.set_label(p.first);
+      graph.set_label(tree.get_label(p.first));
       graph.set_percents((static_cast<double>(p.second) /
           static_cast<double>(places_count)) * 100.0);
       graph.set_colors(colors);
@@ -225,15 +226,75 @@ void Data::show_location_info(
     at_least_one_group_printed = true;
   }
 
-  if (at_least_one_group_printed) {
+  if (Output::is_machine()) {
+    Output::end_report();
+  } else if (at_least_one_group_printed) {
     cout << endl;
     Instanalyzer::msg(Instanalyzer::MSG_INFO, "All location groups printed.");
   }
 }
 
+Data::LocationTree::LocationTree(const vector<LocationGroup>& t_groups):
+    groups(t_groups), nodes(1), levels(t_groups.size()),
+    known(t_groups.size(), 0) {
+  // Empty name always has zero identifier.
+  intern("");
+}
+
+void Data::LocationTree::insert(const Location::Place& t_place) {
+  size_t node = 0;
+
+  for (size_t l = 0; l < groups.size(); ++l) {
+    const string& name = t_place.*groups[l].field;
+    const unsigned int id = intern(name);
+    auto child = nodes[node].children.find(id);
+
+    if (child == nodes[node].children.end()) {
+      Node new_node;
+      new_node.name = id;
+      new_node.parent = node;
+
+      nodes.push_back(new_node);
+      levels[l].push_back(nodes.size() - 1);
+      child = nodes[node].children.emplace(id, nodes.size() - 1).first;
+    }
+
+    node = child->second;
+    ++nodes[node].count;
+    if (id != 0) {
+      ++known[l];
+    }
+  }
+}
+
+string Data::LocationTree::get_label(size_t t_node) const {
+  string label;
+
+  for (; t_node != 0; t_node = nodes[t_node].parent) {
+    const string& name = names[nodes[t_node].name];
+    if (name.empty()) {
+      continue;
+    }
+    label += (label.empty() ? "" : ", ") + name;
+  }
+  return label;
+}
+
+unsigned int Data::LocationTree::intern(const string& t_name) {
+  const auto& id = name_ids.find(t_name);
+  if (id != name_ids.end()) {
+    return id->second;
+  }
+
+  names.push_back(t_name);
+  name_ids.emplace(t_name, names.size() - 1);
+  return names.size() - 1;
+}
+
 set<Location::Coord> Data::get_coords(
     const Profile& t_profile, const unsigned int& t_radius) {
   using namespace filesystem;
+  const Timings::Scope timing(Timings::PHASE_COORDS);
 
   cout << "\rProcessing posts..." << flush;
 
@@ -278,175 +339,836 @@ set<Location::Coord> Data::get_coords(
   return coords;
 }
 
-void Data::show_posts_top(const Profile& t_profile, const int t_count) {
+void Data::show_posts_top(const Profile& t_profile, const int t_count,
+    const PostsQuery& t_query) {
+  const Trace::Scope trace("Data::show_posts_top");
   t_profile.check();
 
   cout << "\rProcessing posts..." << flush;
-  const set<json>& json_posts = t_profile.get_posts();
-  vector<Post> posts;
-
-  for (const auto& p : json_posts) {
-    if (!Utils::has_json_node(p, {"node", "shortcode"}) ||
-        !Utils::has_json_node(p, {"node", "edge_media_preview_like", "count"})) {
-      continue;
+  const PostsIndex& index = get_posts_index(t_profile);
+
+  // Posts, created in requested period, are continuous slice.
+  const uint32_t begin = lower_bound(index.times.cbegin(), index.times.cend(),
+      t_query.since) - index.times.cbegin();
+  const uint32_t end = upper_bound(index.times.cbegin() + begin,
+      index.times.cend(), t_query.until) - index.times.cbegin();
+  const uint32_t slice = end - begin;
+
+  const bool is_reverse = t_count < 0;
+  const uint32_t count = t_count == 0 ?
+      slice : min<uint32_t>(slice, abs(t_count));
+  vector<uint32_t> top;
+  top.reserve(count);
+
+  if (t_query.order == ORDER_RECENT) {
+    for (uint32_t i = 0; i < count; ++i) {
+      top.push_back(is_reverse ? begin + i : end - 1 - i);
     }
+  } else {
+    const vector<uint32_t>& order = t_query.order == ORDER_LIKES ?
+        index.by_likes : index.by_comments;
 
-    const string& shortcode = p["node"]["shortcode"];
-    if (!shortcode.empty()) {
-      Post post;
-      post.set_shortcode(shortcode);
-      post.set_likes(p["node"]["edge_media_preview_like"]["count"]);
-
-      if (Utils::has_json_node(p, {"node", "taken_at_timestamp"})) {
-        post.set_creation_time(p["node"]["taken_at_timestamp"]);
+    if (!order.empty() && slice == index.posts.size()) {
+      if (is_reverse) {
+        top.assign(order.crbegin(), order.crbegin() + count);
       } else {
-        post.set_creation_time(0);
+        top.assign(order.cbegin(), order.cbegin() + count);
       }
-      posts.push_back(post);
+    } else {
+      // Only posts of slice are touched, and only first "count"
+      // of them are sorted.
+      const auto& cmp = get_posts_cmp(index, t_query.order);
+      top.resize(slice);
+      iota(top.begin(), top.end(), begin);
+
+      partial_sort(top.begin(), top.begin() + count, top.end(),
+          [&cmp, &is_reverse] (const uint32_t lhs, const uint32_t rhs) {
+        return is_reverse ? cmp(rhs, lhs) : cmp(lhs, rhs);
+      });
+      top.resize(count);
     }
   }
 
-  const auto& cmp = [&t_count] (const Post& lhs, const Post& rhs) {
-    return t_count < 0 ? (lhs.get_likes() < rhs.get_likes()) :
-        (lhs.get_likes() > rhs.get_likes());
-  };
-  sort(posts.begin(), posts.end(), cmp);
-
   cout << Term::clear_line() << endl;
-  if (posts.empty()) {
+  if (top.empty()) {
     Instanalyzer::msg(Instanalyzer::MSG_WARN, "No posts!");
     return;
   }
 
-  vector<Post>::const_iterator end_it;
-  if (t_count == 0) {
-    end_it = posts.cend();
-  } else {
-    if (static_cast<size_t>(abs(t_count)) > posts.size()) {
-      end_it = posts.cend();
-    } else {
-      end_it = posts.cbegin() + abs(t_count);
+  if (Output::is_machine()) {
+    Output::begin_report("top_posts",
+        {"rank", "shortcode", "url", "likes", "comments", "timestamp"});
+    for (size_t i = 0; i < top.size(); ++i) {
+      const Post& p = index.posts[top[i]];
+      Output::write_record({i + 1, p.get_shortcode(),
+          "https://instagram.com/p/" + p.get_shortcode(), p.get_likes(),
+          p.get_comments_count(),
+          static_cast<long long>(p.get_creation_time())});
     }
+    Output::end_report();
+    return;
   }
 
   const time_t& time_zero = 0;
   ostringstream time_zone;
   time_zone << put_time(localtime(&time_zero), "%Z");
 
-  cout << Term::process_colors("#{bold}Top posts (#{gray_out}" +
-      time_zone.str() + "#{reset} time zone" + string(t_count < 0 ?
-      ", #{red_out}reverse#{reset}#{bold}" : "") + "):#{reset}") << endl;
+  static const map<PostsOrder, string> order_names = {
+    {ORDER_LIKES, ""},
+    {ORDER_COMMENTS, " by comments"},
+    {ORDER_RECENT, " by date"}
+  };
 
-  for (auto p = posts.cbegin(); p != end_it; ++p) {
-    const string& item = "#{bold}" +
-        to_string((p - posts.cbegin()) + 1) + ".#{reset}";
-    const string& likes = "#{yellow_out}" + to_string(p->get_likes()) +
-        "#{reset} like" + (p->get_likes() == 1 ? "" : "s");
+  string period;
+  const auto& add_date = [&period] (const string& name, const time_t& t) {
+    ostringstream date;
+    date << put_time(localtime(&t), "%b %d %Y");
+    period += ", " + name + " #{cream_out}" + date.str() + "#{reset}#{bold}";
+  };
+  if (t_query.since != PostsQuery().since) {
+    add_date("since", t_query.since);
+  }
+  if (t_query.until != PostsQuery().until) {
+    add_date("until", t_query.until);
+  }
 
-    const time_t& creation_time = p->get_creation_time();
+  cout << Term::process_colors("#{bold}Top posts" +
+      order_names.at(t_query.order) + " (#{gray_out}" + time_zone.str() +
+      "#{reset}#{bold} time zone" + string(t_count < 0 ?
+      ", #{red_out}reverse#{reset}#{bold}" : "") + period + "):#{reset}")
+      << endl;
+
+  for (size_t i = 0; i < top.size(); ++i) {
+    const Post& p = index.posts[top[i]];
+    const string& item = "#{bold}" + to_string(i + 1) + ".#{reset}";
+    string stats = "#{yellow_out}" + to_string(p.get_likes()) +
+        "#{reset} like" + (p.get_likes() == 1 ? "" : "s");
+
+    if (t_query.order == ORDER_COMMENTS) {
+      stats += ", #{yellow_out}" + to_string(p.get_comments_count()) +
+          "#{reset} comment" + (p.get_comments_count() == 1 ? "" : "s");
+    }
+
+    const time_t& creation_time = p.get_creation_time();
     ostringstream date;
     date << put_time(localtime(&creation_time), "%a %b %d %H:%M %Y");
 
     cout << Term::process_colors("  " + item + "#{cream_out} instagram.com/p/" +
-        p->get_shortcode() + " #{reset}(" + likes + (creation_time == 0 ?
+        p.get_shortcode() + " #{reset}(" + stats + (creation_time == 0 ?
         "" : ", " + date.str()) + ")#{reset}") << endl;
   }
 }
 
-set<Profile::TaggedProfile> Data::get_tagged_profiles(const Profile& t_owner) {
-  const set<json>& posts = t_owner.get_posts();
-  set<Profile::TaggedProfile> tagged_profiles;
-
-  typedef void (*profile_setter) (Profile&, const json::value_type&);
-  const map<string, profile_setter>& setters = {
-    {"id", [] (Profile& prof, const json::value_type& val) {
-      prof.set_id(val);
-    }},
-    {"username", [] (Profile& prof, const json::value_type& val) {
-      prof.set_name(val);
-    }},
-    {"full_name", [] (Profile& prof, const json::value_type& val) {
-      prof.set_full_name(val);
-    }},
-    {"is_verified", [] (Profile& prof, const json::value_type& val) {
-      prof.set_verified(val);
-    }}
+Data::PostsLoader::PostsLoader(const Profile& t_profile) :
+    m_profile(t_profile), m_stamp(t_profile.get_posts_stamp()) {
+  error_code e;
+  m_file = filesystem::directory_iterator(
+      Profile::get_profiles_path() / t_profile.get_name(), e);
+}
+
+bool Data::PostsLoader::step(const size_t& t_count) {
+  error_code e;
+  for (size_t i = 0; i < t_count; ++i) {
+    if (m_file == filesystem::directory_iterator()) {
+      break;
+    }
+    Profile::read_post_file(*m_file, m_posts);
+    m_file.increment(e);
+  }
+  if (m_file != filesystem::directory_iterator()) {
+    return false;
+  }
+  if (m_stamp == filesystem::file_time_type::min()) {
+    return true;
+  }
+
+  PostsIndex index = build_posts_index(m_posts, m_stamp);
+  for (const auto& o : {ORDER_LIKES, ORDER_COMMENTS}) {
+    vector<uint32_t>& order = o == ORDER_LIKES ?
+        index.by_likes : index.by_comments;
+    order.resize(index.posts.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), get_posts_cmp(index, o));
+  }
+  m_profile.set_cached_posts(m_stamp, move(m_posts));
+  m_posts_indexes[m_profile.get_name()] = move(index);
+  return true;
+}
+
+bool Data::has_posts_index(const Profile& t_profile) {
+  const auto& cached = m_posts_indexes.find(t_profile.get_name());
+  return cached != m_posts_indexes.cend() &&
+      cached->second.stamp == t_profile.get_posts_stamp();
+}
+
+Data::PostsIndex& Data::get_posts_index(const Profile& t_profile) {
+  const Trace::Scope trace("Data::get_posts_index");
+  const auto& stamp = t_profile.get_posts_stamp();
+  const auto& cached = m_posts_indexes.find(t_profile.get_name());
+  if (cached != m_posts_indexes.end() && cached->second.stamp == stamp) {
+    return cached->second;
+  }
+
+  PostsIndex& index = m_posts_indexes[t_profile.get_name()];
+  index = build_posts_index(t_profile.get_posts(), stamp);
+  return index;
+}
+
+Data::PostsIndex Data::build_posts_index(const set<json>& t_posts,
+    const filesystem::file_time_type& t_stamp) {
+  vector<Post> posts;
+  for (const auto& p : t_posts) {
+    if (!Utils::has_json_node(p, {"node", "shortcode"}) ||
+        !Utils::has_json_node(p, {"node", "edge_media_preview_like", "count"})) {
+      continue;
+    }
+
+    const string& shortcode = p["node"]["shortcode"];
+    if (shortcode.empty()) {
+      continue;
+    }
+
+    Post post;
+    post.set_shortcode(shortcode);
+    post.set_likes(p["node"]["edge_media_preview_like"]["count"]);
+
+    if (Utils::has_json_node(p, {"node", "edge_media_to_comment", "count"})) {
+      post.set_comments_count(p["node"]["edge_media_to_comment"]["count"]);
+    } else if (Utils::has_json_node(p,
+        {"node", "edge_media_to_comment", "edges"})) {
+      post.set_comments_count(
+          p["node"]["edge_media_to_comment"]["edges"].size());
+    }
+
+    if (Utils::has_json_node(p, {"node", "taken_at_timestamp"})) {
+      post.set_creation_time(p["node"]["taken_at_timestamp"]);
+    } else {
+      post.set_creation_time(0);
+    }
+    posts.push_back(post);
+  }
+
+  sort(posts.begin(), posts.end(), [] (const Post& lhs, const Post& rhs) {
+    return lhs.get_creation_time() < rhs.get_creation_time();
+  });
+
+  PostsIndex index = {t_stamp, move(posts), {}, {}, {}};
+  index.times.reserve(index.posts.size());
+  for (const auto& p : index.posts) {
+    index.times.push_back(p.get_creation_time());
+  }
+  return index;
+}
+
+function<bool(uint32_t, uint32_t)> Data::get_posts_cmp(
+    const PostsIndex& t_index, const PostsOrder& t_order) {
+  const vector<Post>& posts = t_index.posts;
+  const auto& get_key = t_order == ORDER_COMMENTS ?
+      &Post::get_comments_count : &Post::get_likes;
+
+  return [&posts, get_key] (const uint32_t lhs, const uint32_t rhs) {
+    const unsigned int lhs_key = (posts[lhs].*get_key)(),
+        rhs_key = (posts[rhs].*get_key)();
+    return lhs_key > rhs_key || (lhs_key == rhs_key && lhs > rhs);
   };
+}
+
+Data::TaggedProfiles Data::get_tagged_profiles(const Profile& t_owner) {
+  const Trace::Scope trace("Data::get_tagged_profiles");
+  const set<json>& posts = t_owner.get_posts();
+  TaggedProfiles tagged;
+  // Indexes of profiles by identifier (or by name, if it's unknown).
+  unordered_map<string, uint32_t> ids;
+  // Last post, where profile was tagged, to skip repeated tags.
+  vector<uint32_t> last_posts;
 
   for (const auto& p : posts) {
-    if (!Utils::has_json_node(p, {"node", "shortcode"}) ||
-        !Utils::has_json_node(p, {"node", "edge_media_to_tagged_user", "edges"})) {
+    const auto& post = p.find("node");
+    if (post == p.end() || post->find("shortcode") == post->end()) {
+      continue;
+    }
+
+    const auto& edge = post->find("edge_media_to_tagged_user");
+    if (edge == post->end() || edge->find("edges") == edge->end() ||
+        edge->at("edges").empty()) {
       continue;
     }
 
-    for (const auto& u : p["node"]["edge_media_to_tagged_user"]["edges"]) {
-      if (!Utils::has_json_node(u, {"node", "user"})) {
+    const uint32_t post_idx = tagged.posts.size();
+    tagged.posts.push_back(post->value("shortcode", ""));
+
+    for (const auto& u : edge->at("edges")) {
+      const auto& node = u.find("node");
+      if (node == u.end() || node->find("user") == node->end()) {
         continue;
       }
 
-      const auto& node = u["node"];
-      Profile profile;
+      const json& user = node->at("user");
+      const string& id = user.value("id", "");
+      const string& key = id.empty() ? '@' + user.value("username", "") : id;
+
+      auto profile = ids.find(key);
+      if (profile == ids.end()) {
+        Profile new_profile;
+        new_profile.set_id(id);
+        new_profile.set_name(user.value("username", ""));
+        new_profile.set_full_name(user.value("full_name", ""));
+        new_profile.set_verified(user.value("is_verified", false));
+
+        profile = ids.emplace(key, tagged.profiles.size()).first;
+        tagged.profiles.push_back(new_profile);
+        tagged.counts.push_back(0);
+        last_posts.push_back(UINT32_MAX);
+      }
 
-      for (const auto& s : setters) {
-        if (node["user"].find(s.first) != node["user"].end()) {
-          s.second(profile, node["user"][s.first]);
-        }
+      const uint32_t profile_idx = profile->second;
+      if (last_posts[profile_idx] == post_idx) {
+        continue;
       }
+      last_posts[profile_idx] = post_idx;
+      ++tagged.counts[profile_idx];
+
+      const bool has_position = node->find("x") != node->end() &&
+          node->find("y") != node->end() && node->at("x").is_number() &&
+          node->at("y").is_number();
+      tagged.tags.push_back({profile_idx, post_idx,
+          has_position ? node->at("x").get<float>() : -1.0f,
+          has_position ? node->at("y").get<float>() : -1.0f});
+    }
+  }
+  return tagged;
+}
+
+unordered_map<uint64_t, unsigned int> Data::get_cooccurrences(
+    const TaggedProfiles& t_tagged) {
+  unordered_map<uint64_t, unsigned int> pairs;
+  const auto& tags = t_tagged.tags;
 
-      Profile::TaggedProfile tagged_profile(profile);
-      tagged_profile.post_shortcode = p["node"]["shortcode"];
+  // Tags of every post are continuous range.
+  for (size_t begin = 0, end = 0; begin < tags.size(); begin = end) {
+    while (end < tags.size() && tags[end].post == tags[begin].post) {
+      ++end;
+    }
 
-      if (node.find("x") != node.end() && node.find("y") != node.end()) {
-        tagged_profile.x = node["x"];
-        tagged_profile.y = node["y"];
+    for (size_t i = begin; i < end; ++i) {
+      for (size_t j = i + 1; j < end; ++j) {
+        const uint64_t a = min(tags[i].profile, tags[j].profile),
+            b = max(tags[i].profile, tags[j].profile);
+        ++pairs[(a << 32) | b];
       }
-      tagged_profiles.insert(tagged_profile);
     }
   }
-  return tagged_profiles;
+  return pairs;
 }
 
 void Data::show_tagged_profiles(const Profile& t_owner) {
+  const Trace::Scope trace("Data::show_tagged_profiles");
   t_owner.check();
 
   cout << "\n\rProcessing posts..." << flush;
-  const auto& tagged_profiles = get_tagged_profiles(t_owner);
-  map<Profile, unsigned int> tags_count;
+  const TaggedProfiles& tagged = get_tagged_profiles(t_owner);
 
-  for (const auto& p : tagged_profiles) {
-    if (p.profile->get_name().empty()) {
-      continue;
+  vector<uint32_t> order;
+  order.reserve(tagged.profiles.size());
+  for (uint32_t i = 0; i < tagged.profiles.size(); ++i) {
+    if (!tagged.profiles[i].get_name().empty()) {
+      order.push_back(i);
     }
-    ++tags_count[*p.profile];
   }
 
-  vector<pair<Profile, unsigned int>>
-      tags_count_sorted(tags_count.cbegin(), tags_count.cend());
-  const auto& cmp = [] (const pair<Profile, unsigned int>& lhs,
-      const pair<Profile, unsigned int>& rhs) {
-    return lhs.second > rhs.second;
+  stable_sort(order.begin(), order.end(),
+      [&tagged] (const uint32_t lhs, const uint32_t rhs) {
+    return tagged.counts[lhs] > tagged.counts[rhs];
+  });
+
+  // Pairs of profiles, tagged together, by descending count of posts.
+  const auto& cooccurrences = get_cooccurrences(tagged);
+  vector<pair<uint64_t, unsigned int>> together(
+      cooccurrences.cbegin(), cooccurrences.cend());
+  const auto& cmp = [] (const pair<uint64_t, unsigned int>& lhs,
+      const pair<uint64_t, unsigned int>& rhs) {
+    return lhs.second > rhs.second ||
+        (lhs.second == rhs.second && lhs.first < rhs.first);
+  };
+
+  const size_t shown_pairs = Output::is_machine() ?
+      together.size() : min<size_t>(get_default_posts_count(), together.size());
+  partial_sort(together.begin(), together.begin() + shown_pairs,
+      together.end(), cmp);
+  together.resize(shown_pairs);
+
+  // Posts, where more than one profile is tagged.
+  unsigned int group_posts = 0;
+  for (size_t i = 1; i < tagged.tags.size(); ++i) {
+    if (tagged.tags[i].post == tagged.tags[i - 1].post &&
+        (i == 1 || tagged.tags[i - 2].post != tagged.tags[i].post)) {
+      ++group_posts;
+    }
+  }
+
+  const auto& get_name = [&tagged] (const uint64_t& t_idx) {
+    return tagged.profiles[t_idx].get_name();
   };
-  sort(tags_count_sorted.begin(), tags_count_sorted.end(), cmp);
 
   cout << Term::clear_line() << flush;
-  if (tags_count_sorted.empty()) {
+  if (order.empty()) {
     Instanalyzer::msg(Instanalyzer::MSG_WARN, "No tagged profiles!");
     return;
   }
 
-  cout << Term::process_colors("#{bold}> Often tagged profiles:#{reset}") << endl;
-  const auto& graph_style = Graph::get_random_style();
+  if (Output::is_machine()) {
+    Output::begin_report("tagged",
+        {"username", "tags", "percents", "is_owner"});
+    for (const auto& i : order) {
+      Output::write_record({get_name(i), tagged.counts[i],
+          static_cast<double>(tagged.counts[i]) / tagged.tags.size() * 100.0,
+          get_name(i) == t_owner.get_name()});
+    }
+
+    Output::begin_report("tagged_together",
+        {"username", "other_username", "posts", "percents"});
+    for (const auto& p : together) {
+      Output::write_record({get_name(p.first >> 32),
+          get_name(p.first & UINT32_MAX), p.second,
+          static_cast<double>(p.second) / group_posts * 100.0});
+    }
+    Output::end_report();
+    return;
+  }
+
+  cout << Term::process_colors("#{bold}> Often tagged profiles:#{reset}") <<
+      endl;
+  vector<Graph> graphs;
+  Graph::Colors graph_style = Graph::get_random_style();
+
+  for (const auto& i : order) {
+    const unsigned int count = tagged.counts[i];
 
-  for (const auto& p : tags_count_sorted) {
     Graph graph;
+    graph.set_label('@' + get_name(i) + " (" + to_string(count) + " time" +
+        (count == 1 ? "" : "s") + ')');
+    graph.set_bold_text(get_name(i) == t_owner.get_name());
+    graph.set_colors(graph_style);
+    graph.set_percents(
+        (static_cast<double>(count) / tagged.tags.size()) * 100.0);
+    graphs.push_back(graph);
+  }
+  Graph::draw_graphs(cout, graphs);
+
+  if (together.empty()) {
+    return;
+  }
 
-    graph.set_label('@' + p.first.get_name() + " (" + to_string(p.second) +
-        " time" + (p.second == 1 ? "" : "s") + ')');
-    graph.set_bold_text(p.first.get_name() == t_owner.get_name());
+  cout << Term::process_colors(
+      "\n#{bold}> Often tagged together:#{reset}") << endl;
+  graphs.clear();
+  graph_style = Graph::get_random_style();
+
+  for (const auto& p : together) {
+    Graph graph;
+    graph.set_label('@' + get_name(p.first >> 32) + " + @" +
+        get_name(p.first & UINT32_MAX) + " (" + to_string(p.second) +
+        " post" + (p.second == 1 ? "" : "s") + ')');
+    graph.set_bold_text(false);
     graph.set_colors(graph_style);
-    graph.set_percents((static_cast<double>(p.second) /
-        tagged_profiles.size()) * 100.0);
+    graph.set_percents((static_cast<double>(p.second) / group_posts) * 100.0);
+    graphs.push_back(graph);
+  }
+  Graph::draw_graphs(cout, graphs);
+}
+
+void Data::show_tags_heatmap(const Profile& t_owner) {
+  const Trace::Scope trace("Data::show_tags_heatmap");
+  t_owner.check();
+
+  cout << "\rProcessing posts..." << flush;
+  const TaggedProfiles& tagged = get_tagged_profiles(t_owner);
+  cout << Term::clear_line() << flush;
 
-    graph.draw(cout);
+  // Heatmaps are: overall one and ones of most tagged profiles.
+  vector<uint32_t> profiles;
+  for (uint32_t i = 0; i < tagged.profiles.size(); ++i) {
+    if (!tagged.profiles[i].get_name().empty()) {
+      profiles.push_back(i);
+    }
+  }
+
+  const size_t shown = Output::is_machine() ?
+      profiles.size() : min<size_t>(SHOWN_HEATMAPS, profiles.size());
+  partial_sort(profiles.begin(), profiles.begin() + shown, profiles.end(),
+      [&tagged] (const uint32_t lhs, const uint32_t rhs) {
+    return tagged.counts[lhs] > tagged.counts[rhs] ||
+        (tagged.counts[lhs] == tagged.counts[rhs] && lhs < rhs);
+  });
+  profiles.resize(shown);
+
+  // Slot of heatmap for every profile (0 is overall one).
+  vector<uint32_t> slots(tagged.profiles.size(), 0);
+  for (size_t i = 0; i < profiles.size(); ++i) {
+    slots[profiles[i]] = i + 1;
+  }
+
+  // All heatmaps are in one flat array, tags are accumulated by
+  // cells and then smoothed by separable kernel (1, 2, 1) / 4.
+  const size_t cells = HEATMAP_SIZE * HEATMAP_SIZE;
+  vector<float> heatmaps((profiles.size() + 1) * cells, 0.0f);
+  unsigned int positioned = 0;
+
+  for (const auto& t : tagged.tags) {
+    if (t.x < 0 || t.y < 0) {
+      continue;
+    }
+
+    const unsigned int column = min(static_cast<unsigned int>(
+        t.x * HEATMAP_SIZE), HEATMAP_SIZE - 1);
+    const unsigned int row = min(static_cast<unsigned int>(
+        t.y * HEATMAP_SIZE), HEATMAP_SIZE - 1);
+    const size_t cell = row * HEATMAP_SIZE + column;
+
+    heatmaps[cell] += 1.0f;
+    if (slots[t.profile] != 0) {
+      heatmaps[slots[t.profile] * cells + cell] += 1.0f;
+    }
+    ++positioned;
+  }
+
+  if (positioned == 0) {
+    Instanalyzer::msg(Instanalyzer::MSG_WARN, "No tags with position!");
+    return;
+  }
+
+  vector<float> buffer(cells);
+  for (size_t h = 0; h * cells < heatmaps.size(); ++h) {
+    float* heatmap = heatmaps.data() + h * cells;
+
+    for (unsigned int pass = 0; pass < 2; ++pass) {
+      // Step between neighbour cells: by rows, then by columns.
+      const size_t step = pass == 0 ? 1 : HEATMAP_SIZE;
+
+      for (size_t c = 0; c < cells; ++c) {
+        const size_t pos = pass == 0 ? c % HEATMAP_SIZE : c / HEATMAP_SIZE;
+        const float prev = pos == 0 ? 0.0f : heatmap[c - step];
+        const float next = pos == HEATMAP_SIZE - 1 ? 0.0f : heatmap[c + step];
+        buffer[c] = (prev + 2.0f * heatmap[c] + next) / 4.0f;
+      }
+      copy(buffer.cbegin(), buffer.cend(), heatmap);
+    }
+  }
+
+  if (Output::is_machine()) {
+    Output::begin_report("heatmap",
+        {"username", "row", "column", "density"});
+    for (size_t h = 0; h <= profiles.size(); ++h) {
+      const string& name = h == 0 ? "" : tagged.profiles[profiles[h - 1]]
+          .get_name();
+
+      for (size_t c = 0; c < cells; ++c) {
+        if (heatmaps[h * cells + c] > 0) {
+          Output::write_record({name, c / HEATMAP_SIZE, c % HEATMAP_SIZE,
+              heatmaps[h * cells + c]});
+        }
+      }
+    }
+    Output::end_report();
+    return;
+  }
+
+  draw_heatmap("All tags (" + to_string(positioned) + ')', heatmaps.data());
+  for (size_t i = 0; i < profiles.size(); ++i) {
+    const unsigned int count = tagged.counts[profiles[i]];
+    draw_heatmap('@' + tagged.profiles[profiles[i]].get_name() + " (" +
+        to_string(count) + " tag" + (count == 1 ? "" : "s") + ')',
+        heatmaps.data() + (i + 1) * cells);
+  }
+}
+
+void Data::draw_heatmap(const string& t_title, const float* t_cells) {
+  // Levels of density from the lowest one.
+  static const vector<Term::Color> colors = {
+    Term::COL_BLUE, Term::COL_GREEN, Term::COL_YELLOW, Term::COL_ORANGE,
+    Term::COL_RED
+  };
+  static const string symbols = ".:+*#";
+
+  const float max_val = *max_element(t_cells,
+      t_cells + HEATMAP_SIZE * HEATMAP_SIZE);
+  const string& border = "  +" + string(HEATMAP_SIZE * 2, '-') + "+\n";
+
+  // Escape sequences of levels are rendered once.
+  vector<string> levels;
+  for (size_t l = 0; l < colors.size(); ++l) {
+    levels.push_back(Term::is_colored() ? Term::get_color(colors[l], true) +
+        "  " + Term::reset() : string(2, symbols[l]));
+  }
+
+  string frame = Term::process_colors(
+      "\n#{bold}> " + t_title + ":#{reset}\n") + border;
+  for (unsigned int r = 0; r < HEATMAP_SIZE; ++r) {
+    frame += "  |";
+
+    for (unsigned int c = 0; c < HEATMAP_SIZE; ++c) {
+      const float val = t_cells[r * HEATMAP_SIZE + c];
+      if (val <= 0 || max_val <= 0) {
+        frame += "  ";
+        continue;
+      }
+
+      const size_t level = min(colors.size() - 1,
+          static_cast<size_t>(val / max_val * colors.size()));
+      frame += levels[level];
+    }
+    frame += "|\n";
+  }
+
+  frame += border + "  low ";
+  for (const auto& l : levels) {
+    frame += l;
+  }
+  frame += " high\n";
+  cout << frame << flush;
+}
+
+void Data::show_engagement(const Profile& t_profile) {
+  const Trace::Scope trace("Data::show_engagement");
+  t_profile.check();
+
+  cout << "\rProcessing posts..." << flush;
+  const PostsIndex& index = get_posts_index(t_profile);
+  // Posts without time are first, they are skipped.
+  const size_t first_post = upper_bound(index.times.cbegin(),
+      index.times.cend(), 0) - index.times.cbegin();
+  const size_t count = index.times.size() - first_post;
+  cout << Term::clear_line() << flush;
+
+  if (count == 0) {
+    Instanalyzer::msg(Instanalyzer::MSG_WARN, "No posts!");
+    return;
+  }
+
+  // Average likes of last ROLLING_WINDOW posts (or less at beginning).
+  vector<double> rolling(count);
+  unsigned long long window_likes = 0, total_likes = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    window_likes += index.posts[first_post + i].get_likes();
+    total_likes += index.posts[first_post + i].get_likes();
+    if (i >= ROLLING_WINDOW) {
+      window_likes -= index.posts[first_post + i - ROLLING_WINDOW].get_likes();
+    }
+    rolling[i] = static_cast<double>(window_likes) /
+        min<size_t>(i + 1, ROLLING_WINDOW);
+  }
+
+  const auto& months = get_buckets(index, {[] (const time_t& t) -> long {
+    tm date;
+    localtime_r(&t, &date);
+    return (date.tm_year + 1900L) * 12 + date.tm_mon;
+  }, [] (const long& key) -> time_t {
+    tm date = {};
+    date.tm_year = key / 12 - 1900;
+    date.tm_mon = key % 12;
+    date.tm_mday = 1;
+    date.tm_isdst = -1;
+    return mktime(&date);
+  }});
+  const auto& weeks = get_buckets(index, {[] (const time_t& t) -> long {
+    tm date;
+    localtime_r(&t, &date);
+    // 1 January 1970 is Thursday, so shift weeks to start on Monday.
+    return ((t + date.tm_gmtoff) / (24 * 3600) + 3) / 7;
+  }, [] (const long& key) -> time_t {
+    // Day of month is normalized by mktime.
+    tm date = {};
+    date.tm_year = 70;
+    date.tm_mday = 1 + key * 7 - 3;
+    date.tm_isdst = -1;
+    return mktime(&date);
+  }});
+
+  // Hours of day don't grow with time, so they're counted separately.
+  vector<Bucket> hours(24);
+  for (size_t h = 0; h < hours.size(); ++h) {
+    hours[h] = {static_cast<long>(h), 0, 0, 0};
+  }
+  for (size_t i = first_post; i < index.times.size(); ++i) {
+    tm date;
+    localtime_r(&index.times[i], &date);
+    ++hours[date.tm_hour].posts;
+    hours[date.tm_hour].likes += index.posts[i].get_likes();
+  }
+
+  const auto& average = [] (const Bucket& b) {
+    return b.posts == 0 ? 0.0 : static_cast<double>(b.likes) / b.posts;
+  };
+  const auto& best_hour = max_element(hours.cbegin(), hours.cend(),
+      [&average] (const Bucket& lhs, const Bucket& rhs) {
+    return average(lhs) < average(rhs);
+  });
+
+  if (Output::is_machine()) {
+    const auto& format_time = [] (const time_t& t, const char* format) {
+      char str[32];
+      tm date;
+      localtime_r(&t, &date);
+      strftime(str, sizeof(str), format, &date);
+      return string(str);
+    };
+
+    Output::begin_report("engagement_posts",
+        {"timestamp", "likes", "rolling_likes"});
+    for (size_t i = 0; i < count; ++i) {
+      Output::write_record({static_cast<long long>(index.times[first_post + i]),
+          index.posts[first_post + i].get_likes(), rolling[i]});
+    }
+
+    Output::begin_report("engagement_months", {"month", "posts", "likes"});
+    for (const auto& m : months) {
+      Output::write_record({format_time(m.begin, "%Y-%m"), m.posts,
+          average(m)});
+    }
+
+    // Weeks are identified by date of their Monday.
+    Output::begin_report("engagement_weeks", {"week", "posts", "likes"});
+    for (const auto& w : weeks) {
+      Output::write_record({format_time(w.begin, "%Y-%m-%d"), w.posts,
+          average(w)});
+    }
+
+    Output::begin_report("engagement_hours", {"hour", "posts", "likes"});
+    for (const auto& h : hours) {
+      Output::write_record({h.key, h.posts, average(h)});
+    }
+    Output::end_report();
+    return;
+  }
+
+  const time_t& time_zero = 0;
+  ostringstream time_zone, period;
+  time_zone << put_time(localtime(&time_zero), "%Z");
+
+  const time_t& first = index.times[first_post], last = index.times.back();
+  period << put_time(localtime(&first), "%b %Y") << " - " <<
+      put_time(localtime(&last), "%b %Y");
+
+  const double weeks_count = max(1.0, (last - first) / (7.0 * 24 * 3600));
+  const auto& format_double = [] (const double& val) {
+    char str[32];
+    snprintf(str, sizeof(str), "%.1f", val);
+    return string(str);
+  };
+
+  cout << Term::process_colors("#{bold}> Engagement (#{gray_out}" +
+      time_zone.str() + "#{reset}#{bold} time zone):#{reset}\n"
+      "  Posts: #{yellow_out}" + to_string(count) + "#{reset} (" +
+      period.str() + "), #{yellow_out}" + format_double(count / weeks_count) +
+      "#{reset} per week, #{yellow_out}" +
+      format_double(count / max(1.0, weeks_count * 12 / 52)) +
+      "#{reset} per month.\n  Likes: #{yellow_out}" +
+      format_double(static_cast<double>(total_likes) / count) +
+      "#{reset} per post, last " + to_string(min<size_t>(count,
+      ROLLING_WINDOW)) + " posts: #{yellow_out}" +
+      format_double(rolling.back()) + "#{reset} per post.") << endl;
+
+  cout << Term::process_colors("\n#{bold}> Likes by month (last " +
+      to_string(SHOWN_PERIODS) + "):#{reset}") << endl;
+  draw_buckets(months, "%b %Y", true);
+
+  cout << Term::process_colors("\n#{bold}> Posts by week (last " +
+      to_string(SHOWN_PERIODS) + "):#{reset}") << endl;
+  draw_buckets(weeks, "%b %d %Y", false);
+
+  cout << Term::process_colors(
+      "\n#{bold}> Likes by hour of posting:#{reset}") << endl;
+  vector<Graph> graphs;
+  const Graph::Colors& colors = Graph::get_random_style();
+  const double best_likes = average(*best_hour);
+
+  for (const auto& h : hours) {
+    if (h.posts == 0) {
+      continue;
+    }
+
+    char label[64];
+    snprintf(label, sizeof(label), "%02ld:00 - %.1f likes, %u post%s",
+        h.key, average(h), h.posts, h.posts == 1 ? "" : "s");
+
+    Graph graph;
+    graph.set_label(label);
+    graph.set_percents(best_likes == 0 ? 0 : average(h) / best_likes * 100.0);
+    graph.set_colors(colors);
+    graph.set_bold_text(h.key == best_hour->key);
+    graphs.push_back(graph);
+  }
+  Graph::draw_graphs(cout, graphs);
+
+  char best[16];
+  snprintf(best, sizeof(best), "%02ld:00", best_hour->key);
+  cout << endl;
+  Instanalyzer::msg(Instanalyzer::MSG_INFO, Term::process_colors(
+      "Best hour for posting: #{yellow_out}" + string(best) + "#{reset}."));
+}
+
+vector<Data::Bucket> Data::get_buckets(const PostsIndex& t_index,
+    const Period& t_period) {
+  vector<Bucket> buckets;
+
+  for (size_t i = upper_bound(t_index.times.cbegin(), t_index.times.cend(),
+      0) - t_index.times.cbegin(); i < t_index.times.size(); ++i) {
+    const long key = t_period.get_key(t_index.times[i]);
+    if (buckets.empty() || buckets.back().key != key) {
+      for (long k = buckets.empty() ? key : buckets.back().key + 1; k <= key;
+          ++k) {
+        buckets.push_back({k, t_period.get_begin(k), 0, 0});
+      }
+    }
+
+    ++buckets.back().posts;
+    buckets.back().likes += t_index.posts[i].get_likes();
+  }
+  return buckets;
+}
+
+void Data::draw_buckets(const vector<Bucket>& t_buckets,
+    const string& t_time_format, const bool& t_show_likes) {
+  const auto& begin_it = t_buckets.size() > SHOWN_PERIODS ?
+      t_buckets.cend() - SHOWN_PERIODS : t_buckets.cbegin();
+
+  // Bars are relative to maximal value among shown periods.
+  double max_val = 0;
+  const auto& get_val = [&t_show_likes] (const Bucket& b) -> double {
+    if (!t_show_likes) {
+      return b.posts;
+    }
+    return b.posts == 0 ? 0 : static_cast<double>(b.likes) / b.posts;
+  };
+  for (auto b = begin_it; b != t_buckets.cend(); ++b) {
+    max_val = max(max_val, get_val(*b));
+  }
+
+  vector<Graph> graphs;
+  const Graph::Colors& colors = Graph::get_random_style();
+
+  for (auto b = begin_it; b != t_buckets.cend(); ++b) {
+    ostringstream label;
+    label << put_time(localtime(&b->begin), t_time_format.c_str());
+
+    char details[64];
+    if (t_show_likes && b->posts == 0) {
+      snprintf(details, sizeof(details), " - no posts");
+    } else if (t_show_likes) {
+      snprintf(details, sizeof(details), " - %.1f likes, %u post%s",
+          get_val(*b), b->posts, b->posts == 1 ? "" : "s");
+    } else {
+      snprintf(details, sizeof(details), " - %u post%s",
+          b->posts, b->posts == 1 ? "" : "s");
+    }
+
+    Graph graph;
+    graph.set_label(label.str() + details);
+    graph.set_percents(max_val == 0 ? 0 : get_val(*b) / max_val * 100.0);
+    graph.set_colors(colors);
+    graph.set_bold_text(false);
+    graphs.push_back(graph);
   }
+  Graph::draw_graphs(cout, graphs);
 }
@@ -17,40 +17,210 @@
 
 #pragma once
 
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "nlohmann/json.hpp"
 
 #include "location.hpp"
+#include "post.hpp"
 #include "profile.hpp"
 #include "term.hpp"
 
 class Data {
 public:
-  typedef std::string (*val_parser)(const nlohmann::json&);
-
   static void show_profile_info(const Profile&);
   static void show_location_info(const Profile& profile,
       const unsigned int& radius = Location::get_default_radius());
 
+  enum PostsOrder {
+    ORDER_LIKES,
+    ORDER_COMMENTS,
+    ORDER_RECENT
+  };
+
+  struct PostsQuery {
+    PostsQuery(): order(ORDER_LIKES), since(0),
+        until(std::numeric_limits<std::time_t>::max()) {}
+
+    PostsOrder order;
+    // Period of creation time (inclusive).
+    std::time_t since, until;
+  };
+
   inline static int get_default_posts_count() { return 10; }
-  // If "count" is negative number, then will be printed less liked posts.
+  // If "count" is negative number, then will be printed posts
+  // from the end of order (less liked, commented or oldest).
   static void show_posts_top(const Profile& profile,
-      const int count = get_default_posts_count());
+      const int count = get_default_posts_count(),
+      const PostsQuery& = PostsQuery());
+  // Loader of posts and their index with all sort orders, so next
+  // queries only select from them. Useful for processes which serve many
+  // queries. Posts are read by parts, so process may do other work
+  // between them, and result is stored to caches when all are read.
+  class PostsLoader {
+  public:
+    explicit PostsLoader(const Profile&);
+    // Read next "count" posts. Return true when loading is finished.
+    bool step(const std::size_t& count);
+
+  private:
+    Profile m_profile;
+    // Stamp is taken before loading, so changes during it outdate result.
+    std::filesystem::file_time_type m_stamp;
+    std::filesystem::directory_iterator m_file;
+    std::set<nlohmann::json> m_posts;
+  };
+  // Whether index is built and local copy didn't change since then.
+  static bool has_posts_index(const Profile&);
 
-  static std::set<Profile::TaggedProfile> get_tagged_profiles(const Profile&);
+  // Profiles tagged on posts. Profiles are interned, so tags are
+  // stored in flat arrays of their indexes.
+  struct TaggedProfiles {
+    struct Tag {
+      std::uint32_t profile;
+      std::uint32_t post;
+      // Position on picture (from 0 to 1), negative if unknown.
+      float x, y;
+    };
+
+    std::vector<Profile> profiles;
+    // Shortcodes of posts.
+    std::vector<std::string> posts;
+    // Ordered by post, every profile is tagged once per post.
+    std::vector<Tag> tags;
+    // Count of posts, where profile is tagged.
+    std::vector<unsigned int> counts;
+  };
+
+  static TaggedProfiles get_tagged_profiles(const Profile&);
+  // Show often tagged profiles and profiles often tagged together.
   static void show_tagged_profiles(const Profile&);
+  // Show density of tags on pictures, overall and for most tagged profiles.
+  static void show_tags_heatmap(const Profile&);
+
+  // Likes and posting frequency over time (by months, weeks
+  // and hours of day) with rolling average of likes.
+  static void show_engagement(const Profile&);
 
 private:
+  // Field of profile info, which value is at "path" in "node" object.
+  struct ProfileField {
+    std::string name;
+    std::vector<std::string> path;
+    // Color of value in terminal.
+    std::string color;
+  };
+
+  // Posts of profile sorted by creation time (so periods are found by
+  // binary search) and orders of their indexes by other keys.
+  struct PostsIndex {
+    std::filesystem::file_time_type stamp;
+    std::vector<Post> posts;
+    std::vector<std::time_t> times;
+    // Sorted by descending likes and comments, empty if not built yet.
+    std::vector<std::uint32_t> by_likes, by_comments;
+  };
+
+  // Posts of one time period (month, week or hour of day).
+  struct Bucket {
+    long key;
+    // Beginning of period.
+    std::time_t begin;
+    unsigned int posts;
+    unsigned long long likes;
+  };
+
+  // Kind of periods (months or weeks), which are numbered by keys
+  // growing with time (in local time).
+  struct Period {
+    // Return key of period which time belongs to.
+    long (*get_key)(const std::time_t&);
+    // Return beginning of period with key.
+    std::time_t (*get_begin)(const long&);
+  };
+
   struct LocationGroup {
     std::string name;
-    std::vector<std::string*> address_tree;
+    // Field of place which represents this group level.
+    std::string Location::Place::* field;
+  };
+
+  // Hierarchy of places (country -> state -> ...) where every node holds
+  // count of places, which addresses pass through it. Names are interned.
+  struct LocationTree {
+    struct Node {
+      unsigned int name;
+      std::size_t parent;
+      unsigned int count = 0;
+      std::map<unsigned int, std::size_t> children;
+    };
+
+    explicit LocationTree(const std::vector<LocationGroup>&);
+
+    void insert(const Location::Place&);
+    // Return label of node in format "name, parent name, ...".
+    std::string get_label(std::size_t node) const;
+    unsigned int intern(const std::string&);
+
+    const std::vector<LocationGroup>& groups;
+    std::vector<Node> nodes;
+    // Indexes of nodes on every level (without root).
+    std::vector<std::vector<std::size_t>> levels;
+    // Count of places with known name on every level.
+    std::vector<unsigned int> known;
+
+    std::vector<std::string> names;
+    std::unordered_map<std::string, unsigned int> name_ids;
   };
 
+  static PostsIndex& get_posts_index(const Profile&);
+  static PostsIndex build_posts_index(const std::set<nlohmann::json>& posts,
+      const std::filesystem::file_time_type& stamp);
+  // Return comparator of indexes of posts for order. Posts with
+  // equal key are ordered from newest.
+  static std::function<bool(std::uint32_t, std::uint32_t)> get_posts_cmp(
+      const PostsIndex&, const PostsOrder&);
+
+  // Return sparse matrix of counts of posts, where two profiles are
+  // tagged together. Key contains indexes of both profiles (less first).
+  static std::unordered_map<std::uint64_t, unsigned int> get_cooccurrences(
+      const TaggedProfiles&);
+
+  // Render grid of HEATMAP_SIZE x HEATMAP_SIZE cells (by rows).
+  static void draw_heatmap(const std::string& title, const float* cells);
+
+  // Posts are sorted by time, so buckets are collected in one pass.
+  // Periods without posts between first and last post are kept too.
+  // Posts without time are skipped.
+  static std::vector<Bucket> get_buckets(const PostsIndex&, const Period&);
+  static void draw_buckets(const std::vector<Bucket>&,
+      const std::string& time_format, const bool& show_likes);
+
   static std::set<Location::Coord> get_coords(const Profile& profile,
       const unsigned int& radius = Location::get_default_radius());
 
-  static const std::vector<std::pair<std::string, val_parser>> m_profile_data;
+  // Return null if value is absent or empty.
+  static nlohmann::json get_profile_value(const nlohmann::json& profile,
+      const ProfileField&);
+
+  static const std::vector<ProfileField> m_profile_data;
+  static std::map<std::string, PostsIndex> m_posts_indexes;
+  // Count of last posts for rolling average of likes.
+  static const unsigned int ROLLING_WINDOW;
+  // Count of last months and weeks, which are shown in table format.
+  static const unsigned int SHOWN_PERIODS;
+  // Count of cells of heatmap by both axes.
+  static const unsigned int HEATMAP_SIZE;
+  // Count of most tagged profiles with own heatmap.
+  static const unsigned int SHOWN_HEATMAPS;
 };
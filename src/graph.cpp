@@ -17,10 +17,14 @@
 
 #include "graph.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
 #include <random>
+#include <unordered_map>
+#include <utility>
 
-#include "boost/format.hpp"
-#include "boost/regex.hpp"
+#include "timings.hpp"
 
 using namespace std;
 
@@ -43,44 +47,98 @@ const vector<Graph::Colors> Graph::m_graph_light_styles = {
 };
 
 int Graph::draw_graphs(ostream& t_os, const vector<Graph>& t_graphs) {
-  using namespace boost;
-
+  const Timings::Scope timing(Timings::PHASE_GRAPHS);
   static const unsigned short MAX_TERM_COLUMNS = 80;
-  const unsigned int term_columns = (Term::get_columns() > MAX_TERM_COLUMNS) ?
-      MAX_TERM_COLUMNS : Term::get_columns();
-  size_t idx = 0;
-
-  for (const auto& g : t_graphs) {
-    string percents = (format("%.1f %%") % g.get_percents()).str();
-    // Delete all text colors and styles.
-    string label = regex_replace(g.get_label(),
-        regex("\x1b\\[[[:digit:];]+m"), "");
+  const unsigned int term_columns = min(
+      Term::get_columns(), static_cast<unsigned int>(MAX_TERM_COLUMNS));
+
+  // Escape sequences of graph start and of its end (before text
+  // out of graph). Rendered once for every combination of colors.
+  unordered_map<unsigned int, pair<string, string>> styles;
+  const auto& get_style = [&styles] (const Graph& t_graph)
+      -> const pair<string, string>& {
+    const Colors& col = t_graph.get_colors();
+    const unsigned int key = ((col.graph * 16 + col.text_in) * 16 +
+        col.text_out) * 2 + t_graph.is_bold_text();
+
+    auto style = styles.find(key);
+    if (style == styles.end()) {
+      const string& bold = t_graph.is_bold_text() ? Term::bold() : "";
+      style = styles.emplace(key, make_pair(Term::get_color(col.graph, true) +
+          Term::get_color(col.text_in) + bold,
+          Term::reset() + Term::get_color(col.text_out) + bold)).first;
+    }
+    return style->second;
+  };
+
+  // Whole frame is written at once.
+  static string frame, text;
+  frame.clear();
+  int result = -1;
+
+  for (size_t idx = 0; idx < t_graphs.size(); ++idx) {
+    const Graph& g = t_graphs[idx];
+
+    char percents[32];
+    const int percents_len = snprintf(
+        percents, sizeof(percents), "%.1f %%", g.get_percents());
     // 1 is space to separate label and percents.
-    const int max_label_len = term_columns - percents.length() - 1;
+    const int max_label_len = term_columns - percents_len - 1;
 
     // 4 is first character of label and three dots.
     if (max_label_len < 4) {
-      return idx;
-    } else if (static_cast<size_t>(max_label_len) < label.length()) {
-      label = label.substr(0, max_label_len - 3) + "...";
+      result = idx;
+      break;
+    }
+
+    // Label without text colors and styles.
+    text.clear();
+    strip_escapes(g.get_label(), text);
+    if (static_cast<size_t>(max_label_len) < text.length()) {
+      text.resize(max_label_len - 3);
+      text += "...";
     }
 
-    const string& graph_start = Term::get_color(g.get_colors().graph, true) +
-        Term::get_color(g.get_colors().text_in) +
-        (g.is_bold_text() ? Term::bold() : "");
-    const size_t spaces = term_columns - label.length() - percents.length(),
-        graph_end_char = term_columns * (g.get_percents() / 100.0) +
-        graph_start.length();
+    text.append(term_columns - text.length() - percents_len, ' ');
+    text.append(percents, percents_len);
 
-    string graph =
-        graph_start + label + string(spaces, ' ') + percents + Term::reset();
-    graph.insert(graph_end_char, Term::reset() + Term::get_color(
-        g.get_colors().text_out) + (g.is_bold_text() ? Term::bold() : ""));
+    const auto& style = get_style(g);
+    const size_t graph_end = min(static_cast<size_t>(
+        term_columns * (g.get_percents() / 100.0)), text.length());
+
+    frame += style.first;
+    frame.append(text, 0, graph_end);
+    frame += style.second;
+    frame.append(text, graph_end, string::npos);
+    frame += Term::reset();
+    frame += '\n';
+  }
+
+  t_os.write(frame.data(), frame.size());
+  t_os.flush();
+  return result;
+}
+
+void Graph::strip_escapes(const string& t_str, string& t_out) {
+  for (size_t i = 0; i < t_str.size();) {
+    // Sequence format: ESC [ <digits or ";"> m.
+    if (t_str[i] == '\x1b' && i + 1 < t_str.size() && t_str[i + 1] == '[') {
+      size_t end = i + 2;
+      while (end < t_str.size() && (isdigit(
+          static_cast<unsigned char>(t_str[end])) || t_str[end] == ';')) {
+        ++end;
+      }
+
+      if (end != i + 2 && end < t_str.size() && t_str[end] == 'm') {
+        i = end + 1;
+        continue;
+      }
+    }
 
-    t_os << graph << endl;
-    ++idx;
+    const size_t next = t_str.find('\x1b', i + 1);
+    t_out.append(t_str, i, next == string::npos ? string::npos : next - i);
+    i = next == string::npos ? t_str.size() : next;
   }
-  return -1;
 }
 
 Graph::Colors Graph::get_random_style() {
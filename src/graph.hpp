@@ -48,10 +48,14 @@ public:
 
   // Return -1 on successful, otherwise graph index
   // which didn't print due to terminal didn't have space (columns) for it.
+  // All graphs are rendered into one buffer and written at once.
   static int draw_graphs(std::ostream&, const std::vector<Graph>&);
   static Colors get_random_style();
 
 private:
+  // Append string without ESC sequences of colors and styles.
+  static void strip_escapes(const std::string&, std::string& out);
+
   std::string m_label;
   double m_percents;
   Colors m_col;
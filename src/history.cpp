@@ -0,0 +1,453 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "history.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include "output.hpp"
+#include "term.hpp"
+
+using namespace nlohmann;
+using namespace std;
+
+const unsigned int History::SHOWN_CHANGES = 10;
+
+void History::save_snapshot(const Profile& t_profile) {
+  using namespace filesystem;
+
+  const vector<time_t>& snapshots = get_snapshots(t_profile);
+  const Snapshot& previous = snapshots.empty() ? Snapshot() :
+      load_snapshots(t_profile, snapshots, {snapshots.size() - 1}).front();
+  const Snapshot& current = make_snapshot(t_profile);
+
+  // Snapshots are named by time, which must be unique.
+  time_t snapshot_time = time(nullptr);
+  if (!snapshots.empty()) {
+    snapshot_time = max(snapshot_time, snapshots.back() + 1);
+  }
+
+  create_directories(get_history_path(t_profile));
+  write_file(get_delta_path(t_profile, snapshot_time),
+      get_delta(previous, current));
+  // The first snapshot is full state already.
+  if (snapshots.empty()) {
+    return;
+  }
+  write_file(get_checkpoint_path(t_profile, snapshot_time),
+      get_delta(Snapshot(), current));
+
+  error_code e;
+  remove(get_checkpoint_path(t_profile, snapshots.back()), e);
+}
+
+vector<time_t> History::get_snapshots(const Profile& t_profile) {
+  using namespace filesystem;
+
+  vector<time_t> snapshots;
+  error_code e;
+
+  for (const auto& f : directory_iterator(get_history_path(t_profile), e)) {
+    if (f.path().extension() != ".ndjson") {
+      continue;
+    }
+
+    try {
+      snapshots.push_back(stoll(f.path().stem().string()));
+    } catch (const exception&) {}
+  }
+  sort(snapshots.begin(), snapshots.end());
+  return snapshots;
+}
+
+void History::show_diff(const Profile& t_profile, const time_t& t_since,
+    const time_t& t_until) {
+  const vector<time_t>& snapshots = get_snapshots(t_profile);
+
+  // Newer snapshot is last one in period, older one is last one
+  // before period (or previous to newer one, if period isn't limited).
+  const size_t to = upper_bound(snapshots.cbegin(), snapshots.cend(),
+      t_until) - snapshots.cbegin();
+  const size_t from = t_since == 0 ? (to < 2 ? 0 : to - 1) :
+      upper_bound(snapshots.cbegin(), snapshots.cend(), t_since) -
+      snapshots.cbegin();
+
+  if (snapshots.size() < 2) {
+    Instanalyzer::msg(Instanalyzer::MSG_WARN, Term::process_colors(
+        "Need two snapshots to compare, found #{yellow_out}" +
+        to_string(snapshots.size()) + "#{reset}. Snapshot is saved on "
+        "every update of profile."));
+    return;
+  } else if (to < 2 || from == 0 || from >= to) {
+    Instanalyzer::msg(Instanalyzer::MSG_WARN,
+        "No snapshots to compare in requested period!");
+    return;
+  }
+
+  cout << "\rProcessing snapshots..." << flush;
+  Snapshot older, newer;
+  try {
+    vector<Snapshot> loaded = load_snapshots(t_profile, snapshots,
+        {from - 1, to - 1});
+    older = move(loaded.front());
+    newer = move(loaded.back());
+  } catch (const exception& e) {
+    cout << Term::clear_line() << flush;
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, e.what());
+    exit(EXIT_FAILURE);
+  }
+
+  struct PostChange {
+    string shortcode;
+    const PostState* before;
+    const PostState* after;
+  };
+  vector<PostChange> posts;
+  unsigned int added_posts = 0, removed_posts = 0;
+
+  merge(older.posts, newer.posts,
+      [&] (const string& t_key, const PostState& t_state) {
+    posts.push_back({t_key, nullptr, &t_state});
+    ++added_posts;
+  }, [&] (const string& t_key, const PostState& t_state) {
+    posts.push_back({t_key, &t_state, nullptr});
+    ++removed_posts;
+  }, [&] (const string& t_key, const PostState& t_old,
+      const PostState& t_new) {
+    posts.push_back({t_key, &t_old, &t_new});
+  });
+
+  // Count of new comments by commentator.
+  unordered_map<string, unsigned int> commentators;
+  unsigned int added_comments = 0, removed_comments = 0;
+
+  merge(older.comments, newer.comments,
+      [&] (const string&, const CommentState& t_state) {
+    ++commentators[t_state.username];
+    ++added_comments;
+  }, [&] (const string&, const CommentState&) {
+    ++removed_comments;
+  }, [] (const string&, const CommentState&, const CommentState&) {});
+
+  set<string> old_commentators;
+  for (const auto& c : older.comments) {
+    old_commentators.insert(c.second.username);
+  }
+
+  const auto& get_likes = [] (const PostState* t_state) {
+    return t_state == nullptr ? 0LL : static_cast<long long>(t_state->likes);
+  };
+  const auto& get_comments = [] (const PostState* t_state) {
+    return t_state == nullptr ? 0LL :
+        static_cast<long long>(t_state->comments);
+  };
+  stable_sort(posts.begin(), posts.end(),
+      [&get_likes] (const PostChange& lhs, const PostChange& rhs) {
+    return get_likes(lhs.after) - get_likes(lhs.before) >
+        get_likes(rhs.after) - get_likes(rhs.before);
+  });
+
+  vector<pair<string, unsigned int>> commentators_sorted(
+      commentators.cbegin(), commentators.cend());
+  sort(commentators_sorted.begin(), commentators_sorted.end(),
+      [] (const pair<string, unsigned int>& lhs,
+      const pair<string, unsigned int>& rhs) {
+    return lhs.second > rhs.second ||
+        (lhs.second == rhs.second && lhs.first < rhs.first);
+  });
+  cout << Term::clear_line() << flush;
+
+  if (Output::is_machine()) {
+    Output::begin_report("diff_posts", {"shortcode", "status", "likes_before",
+        "likes_after", "comments_before", "comments_after"});
+    for (const auto& p : posts) {
+      Output::write_record({p.shortcode, p.before == nullptr ? "added" :
+          (p.after == nullptr ? "removed" : "changed"), get_likes(p.before),
+          get_likes(p.after), get_comments(p.before), get_comments(p.after)});
+    }
+
+    Output::begin_report("diff_commentators",
+        {"username", "new_comments", "is_new"});
+    for (const auto& c : commentators_sorted) {
+      Output::write_record({c.first, c.second,
+          old_commentators.count(c.first) == 0});
+    }
+    Output::end_report();
+    return;
+  }
+
+  const auto& format_time = [] (const time_t& t) {
+    ostringstream ss;
+    ss << put_time(localtime(&t), "%b %d %Y %H:%M");
+    return ss.str();
+  };
+
+  cout << Term::process_colors("#{bold}> Changes of profile #{blue_out}@" +
+      t_profile.get_name() + "#{reset}#{bold} (#{cream_out}" +
+      format_time(snapshots[from - 1]) + "#{reset}#{bold} - #{cream_out}" +
+      format_time(snapshots[to - 1]) + "#{reset}#{bold}):#{reset}\n"
+      "  Posts: #{green_out}+" + to_string(added_posts) + "#{reset}, "
+      "#{red_out}-" + to_string(removed_posts) + "#{reset}.\n"
+      "  Comments: #{green_out}+" + to_string(added_comments) + "#{reset}, "
+      "#{red_out}-" + to_string(removed_comments) + "#{reset}.") << endl;
+
+  unsigned int shown = 0;
+  for (const auto& p : posts) {
+    const long long delta = get_likes(p.after) - get_likes(p.before);
+    if (p.before == nullptr || p.after == nullptr || delta <= 0 ||
+        shown == SHOWN_CHANGES) {
+      continue;
+    }
+
+    if (shown++ == 0) {
+      cout << Term::process_colors(
+          "\n#{bold}> Posts gained most likes:#{reset}") << endl;
+    }
+    cout << Term::process_colors("  #{bold}" + to_string(shown) +
+        ".#{reset}#{cream_out} instagram.com/p/" + p.shortcode +
+        " #{reset}(#{green_out}+" + to_string(delta) + "#{reset} likes: " +
+        to_string(get_likes(p.before)) + " -> " +
+        to_string(get_likes(p.after)) + ")") << endl;
+  }
+
+  shown = 0;
+  for (const auto& c : commentators_sorted) {
+    if (old_commentators.count(c.first) != 0 || shown == SHOWN_CHANGES) {
+      continue;
+    }
+
+    if (shown++ == 0) {
+      cout << Term::process_colors(
+          "\n#{bold}> New commentators:#{reset}") << endl;
+    }
+    cout << Term::process_colors("  #{bold}" + to_string(shown) +
+        ".#{reset} #{blue_out}@" + c.first + "#{reset} (" +
+        to_string(c.second) + " comment" + (c.second == 1 ? "" : "s") +
+        ")") << endl;
+  }
+}
+
+History::Snapshot History::make_snapshot(const Profile& t_profile) {
+  Snapshot snapshot;
+
+  for (const auto& p : t_profile.get_posts(false)) {
+    const auto& node = p.find("node");
+    if (node == p.end()) {
+      continue;
+    }
+
+    const string& shortcode = node->value("shortcode", "");
+    if (shortcode.empty()) {
+      continue;
+    }
+
+    PostState& post = snapshot.posts[shortcode];
+    post.time = node->value("taken_at_timestamp", 0);
+    post.likes = node->value("/edge_media_preview_like/count"_json_pointer, 0);
+    post.comments = node->value("/edge_media_to_comment/count"_json_pointer, 0);
+
+    const auto& edge = node->find("edge_media_to_comment");
+    if (edge == node->end() || edge->find("edges") == edge->end()) {
+      continue;
+    }
+
+    for (const auto& e : edge->at("edges")) {
+      const auto& c = e.find("node");
+      if (c == e.end() || c->value("id", "").empty()) {
+        continue;
+      }
+
+      CommentState& comment = snapshot.comments[c->value("id", "")];
+      comment.post = shortcode;
+      comment.username = c->value("/owner/username"_json_pointer, "");
+      comment.likes = c->value("/edge_liked_by/count"_json_pointer, 0);
+      comment.time = c->value("created_at", 0);
+    }
+  }
+  return snapshot;
+}
+
+vector<History::Snapshot> History::load_snapshots(const Profile& t_profile,
+    const vector<time_t>& t_snapshots, const vector<size_t>& t_indexes) {
+  vector<Snapshot> loaded;
+  Snapshot snapshot;
+  // Index of next snapshot, which changes aren't applied yet.
+  size_t next = 0;
+
+  for (const auto& index : t_indexes) {
+    if (index != 0 && index + 1 == t_snapshots.size()) {
+      snapshot = Snapshot();
+      apply_delta(get_checkpoint_path(t_profile, t_snapshots[index]),
+          snapshot);
+      next = index + 1;
+    }
+
+    for (; next <= index; ++next) {
+      apply_delta(get_delta_path(t_profile, t_snapshots[next]), snapshot);
+    }
+    snapshot.time = t_snapshots[index];
+    loaded.push_back(snapshot);
+  }
+  return loaded;
+}
+
+string History::get_delta(const Snapshot& t_old, const Snapshot& t_new) {
+  // Every line is upsert of fields or removal of one post or comment,
+  // except maps of changed like counts, which are written at end.
+  ostringstream delta;
+  json post_likes = json::object(), comment_likes = json::object();
+
+  merge(t_old.posts, t_new.posts,
+      [&delta] (const string& t_key, const PostState& t_state) {
+    delta << json({{"post", t_key}, {"likes", t_state.likes},
+        {"comments", t_state.comments}, {"time", t_state.time}}) << '\n';
+  }, [&delta] (const string& t_key, const PostState&) {
+    delta << json({{"post", t_key}, {"removed", true}}) << '\n';
+  }, [&delta, &post_likes] (const string& t_key, const PostState& t_old,
+      const PostState& t_new) {
+    if (t_old.comments == t_new.comments && t_old.time == t_new.time) {
+      post_likes[t_key] = t_new.likes;
+      return;
+    }
+
+    json line = {{"post", t_key}};
+    if (t_old.likes != t_new.likes) {
+      line["likes"] = t_new.likes;
+    }
+    if (t_old.comments != t_new.comments) {
+      line["comments"] = t_new.comments;
+    }
+    if (t_old.time != t_new.time) {
+      line["time"] = t_new.time;
+    }
+    delta << line << '\n';
+  });
+
+  merge(t_old.comments, t_new.comments,
+      [&delta] (const string& t_key, const CommentState& t_state) {
+    delta << json({{"comment", t_key}, {"on", t_state.post},
+        {"user", t_state.username}, {"likes", t_state.likes},
+        {"time", t_state.time}}) << '\n';
+  }, [&delta] (const string& t_key, const CommentState&) {
+    delta << json({{"comment", t_key}, {"removed", true}}) << '\n';
+  }, [&delta, &comment_likes] (const string& t_key,
+      const CommentState& t_old, const CommentState& t_new) {
+    if (t_old.post == t_new.post && t_old.username == t_new.username &&
+        t_old.time == t_new.time) {
+      comment_likes[t_key] = t_new.likes;
+      return;
+    }
+
+    json line = {{"comment", t_key}};
+    if (t_old.post != t_new.post) {
+      line["on"] = t_new.post;
+    }
+    if (t_old.username != t_new.username) {
+      line["user"] = t_new.username;
+    }
+    if (t_old.likes != t_new.likes) {
+      line["likes"] = t_new.likes;
+    }
+    if (t_old.time != t_new.time) {
+      line["time"] = t_new.time;
+    }
+    delta << line << '\n';
+  });
+
+  if (!post_likes.empty()) {
+    delta << json({{"post_likes", post_likes}}) << '\n';
+  }
+  if (!comment_likes.empty()) {
+    delta << json({{"comment_likes", comment_likes}}) << '\n';
+  }
+  return delta.str();
+}
+
+void History::apply_delta(const filesystem::path& t_path,
+    Snapshot& t_snapshot) {
+  ifstream ifs(t_path);
+  if (ifs.fail()) {
+    throw runtime_error("Snapshot (" + t_path.string() + ") didn't open!");
+  }
+
+  string line;
+  while (getline(ifs, line)) {
+    if (line.empty()) {
+      continue;
+    }
+
+    try {
+      const json& j = json::parse(line);
+      const bool is_removed = j.value("removed", false);
+
+      // Fields, which are absent, aren't changed (new items are zeroed).
+      if (j.find("post") != j.end()) {
+        const string& key = j["post"];
+        if (is_removed) {
+          t_snapshot.posts.erase(key);
+        } else {
+          PostState& post = t_snapshot.posts[key];
+          post.likes = j.value("likes", post.likes);
+          post.comments = j.value("comments", post.comments);
+          post.time = j.value("time", post.time);
+        }
+      } else if (j.find("comment") != j.end()) {
+        const string& key = j["comment"];
+        if (is_removed) {
+          t_snapshot.comments.erase(key);
+        } else {
+          CommentState& comment = t_snapshot.comments[key];
+          comment.post = j.value("on", comment.post);
+          comment.username = j.value("user", comment.username);
+          comment.likes = j.value("likes", comment.likes);
+          comment.time = j.value("time", comment.time);
+        }
+      } else if (j.find("post_likes") != j.end()) {
+        for (const auto& [key, likes] : j["post_likes"].items()) {
+          t_snapshot.posts[key].likes = likes;
+        }
+      } else if (j.find("comment_likes") != j.end()) {
+        for (const auto& [key, likes] : j["comment_likes"].items()) {
+          t_snapshot.comments[key].likes = likes;
+        }
+      }
+    } catch (const json::exception&) {
+      throw runtime_error("Snapshot (" + t_path.string() + ") is damaged!");
+    }
+  }
+}
+
+void History::write_file(const filesystem::path& t_path,
+    const string& t_data) {
+  const filesystem::path& tmp_path = t_path.parent_path() / "snapshot.tmp";
+  ofstream ofs(tmp_path);
+  ofs << t_data;
+  ofs.close();
+
+  if (ofs.fail()) {
+    throw runtime_error("Snapshot of profile didn't save!");
+  }
+  filesystem::rename(tmp_path, t_path);
+}
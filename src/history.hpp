@@ -0,0 +1,138 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ctime>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "profile.hpp"
+
+class History {
+public:
+  struct PostState {
+    inline bool operator==(const PostState& rhs) const {
+      return likes == rhs.likes && comments == rhs.comments &&
+          time == rhs.time;
+    }
+    inline bool operator!=(const PostState& rhs) const {
+      return !(*this == rhs);
+    }
+
+    unsigned int likes, comments;
+    std::time_t time;
+  };
+
+  struct CommentState {
+    inline bool operator==(const CommentState& rhs) const {
+      return post == rhs.post && username == rhs.username &&
+          likes == rhs.likes && time == rhs.time;
+    }
+    inline bool operator!=(const CommentState& rhs) const {
+      return !(*this == rhs);
+    }
+
+    std::string post, username;
+    unsigned int likes;
+    std::time_t time;
+  };
+
+  // State of posts (by shortcode) and comments (by identifier).
+  struct Snapshot {
+    std::time_t time = 0;
+    std::map<std::string, PostState> posts;
+    std::map<std::string, CommentState> comments;
+  };
+
+  // Save local copy of profile as new snapshot. Only changed fields
+  // against previous snapshot are stored, and like counts, which change
+  // on almost every update, are packed together. Full state of the last
+  // snapshot is kept as checkpoint, so saving reads only one file.
+  static void save_snapshot(const Profile&) noexcept(false);
+  // Return times of saved snapshots, from the oldest.
+  static std::vector<std::time_t> get_snapshots(const Profile&);
+  // Show changes between last snapshot, taken not later than "since"
+  // (or previous one), and last snapshot, taken not later than "until".
+  static void show_diff(const Profile&, const std::time_t& since,
+      const std::time_t& until);
+
+  inline static std::filesystem::path get_history_path(
+      const Profile& t_profile) {
+    return Instanalyzer::get_work_path() / "history" / t_profile.get_name();
+  }
+
+private:
+  // Call "cb_added(key, new)", "cb_removed(key, old)" and
+  // "cb_changed(key, old, new)" walking both sorted maps at once.
+  template<typename T, typename Added, typename Removed, typename Changed>
+  static void merge(const std::map<std::string, T>& t_old,
+      const std::map<std::string, T>& t_new, Added&& t_cb_added,
+      Removed&& t_cb_removed, Changed&& t_cb_changed) {
+    auto o = t_old.cbegin();
+    auto n = t_new.cbegin();
+
+    while (o != t_old.cend() || n != t_new.cend()) {
+      if (n == t_new.cend() || (o != t_old.cend() && o->first < n->first)) {
+        t_cb_removed(o->first, o->second);
+        ++o;
+      } else if (o == t_old.cend() || n->first < o->first) {
+        t_cb_added(n->first, n->second);
+        ++n;
+      } else {
+        if (o->second != n->second) {
+          t_cb_changed(o->first, o->second, n->second);
+        }
+        ++o;
+        ++n;
+      }
+    }
+  }
+
+  // Read state from local copy of profile.
+  static Snapshot make_snapshot(const Profile&);
+  // Return states of snapshots by ascending indexes. The last snapshot is
+  // read from checkpoint, others are restored by changes from the first
+  // one (which is full state), shared changes are applied once.
+  static std::vector<Snapshot> load_snapshots(const Profile&,
+      const std::vector<std::time_t>& snapshots,
+      const std::vector<std::size_t>& indexes) noexcept(false);
+  // Return lines, which turn "old" snapshot into "new" one.
+  static std::string get_delta(const Snapshot& old_snapshot,
+      const Snapshot& new_snapshot);
+  static void apply_delta(const std::filesystem::path&, Snapshot&)
+      noexcept(false);
+  static void write_file(const std::filesystem::path&,
+      const std::string& data) noexcept(false);
+
+  inline static std::filesystem::path get_delta_path(
+      const Profile& t_profile, const std::time_t& t_time) {
+    return get_history_path(t_profile) / (std::to_string(t_time) + ".ndjson");
+  }
+  inline static std::filesystem::path get_checkpoint_path(
+      const Profile& t_profile, const std::time_t& t_time) {
+    return get_history_path(t_profile) /
+        (std::to_string(t_time) + ".checkpoint");
+  }
+
+  // Count of changed items, which are shown in table format.
+  static const unsigned int SHOWN_CHANGES;
+};
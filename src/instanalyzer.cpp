@@ -21,6 +21,10 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <utility>
+#include <vector>
+
+#include "curlpp/cURLpp.hpp"
 
 #include "location.hpp"
 #include "modules.hpp"
@@ -32,6 +36,7 @@ using namespace nlohmann;
 
 filesystem::path Instanalyzer::m_work_path;
 json Instanalyzer::m_config;
+unsigned int Instanalyzer::m_ready_subsystems = 0;
 
 void Instanalyzer::init() {
   using namespace filesystem;
@@ -57,25 +62,46 @@ void Instanalyzer::init() {
   if (Term::is_colored()) {
     Term::init(request_theme());
   }
+}
 
-  manage_cache();
+void Instanalyzer::require(const unsigned int& t_subsystems) {
+  // In order of initialization.
+  static const vector<pair<Subsystems, void (*)()>> inits = {
+    {SUB_CACHE, manage_cache},
+    {SUB_NETWORK, [] { curlpp::initialize(); }},
+    {SUB_GEOCODER, Location::init},
+    {SUB_PROFILES, Profile::init},
+    {SUB_MODULES, [] {
+      // Replay doesn't need Instaloader.
+      if (!Modules::is_replay() &&
+          !filesystem::directory_entry(Modules::get_instaloader_path())
+          .exists()) {
+        msg(MSG_INFO,
+            "Instaloader script doesn't exist, update of modules required.");
+        Modules::update_modules();
+      }
+    }}
+  };
 
-  try {
-    Location::init();
-    Modules::init_interpreter();
-    Profile::init();
-  } catch (const exception& e) {
-    msg(MSG_ERR, e.what());
-    exit(EXIT_FAILURE);
+  unsigned int required = t_subsystems;
+  if (required & SUB_GEOCODER) {
+    required |= SUB_CACHE | SUB_NETWORK;
+  }
+  if (required & SUB_MODULES) {
+    required |= SUB_NETWORK;
   }
 
-  if (!directory_entry(Modules::get_instaloader_path()).exists()) {
-    msg(MSG_INFO,
-        "Instaloader script doesn't exist, update of modules required.");
+  for (const auto& i : inits) {
+    if (!(required & i.first) || (m_ready_subsystems & i.first)) {
+      continue;
+    }
+
+    // Mark before initialization, because it may require other subsystems.
+    m_ready_subsystems |= i.first;
     try {
-      Modules::update_modules();
+      i.second();
     } catch (const exception& e) {
-      msg(MSG_ERR, e.what(), true);
+      msg(MSG_ERR, e.what(), i.first == SUB_MODULES);
       exit(EXIT_FAILURE);
     }
   }
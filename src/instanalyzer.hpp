@@ -30,7 +30,21 @@ public:
     MSG_WARN
   };
 
+  // Subsystems which are initialized on demand, see require().
+  enum Subsystems {
+    SUB_CACHE = 1 << 0,
+    SUB_NETWORK = 1 << 1,
+    SUB_GEOCODER = 1 << 2,
+    SUB_PROFILES = 1 << 3,
+    SUB_MODULES = 1 << 4
+  };
+
+  // Prepare work directory, config and theme only. Everything else
+  // is initialized by the first command which needs it.
   static void init();
+  // Initialize subsystems (mask of Subsystems) together with their
+  // dependencies, if they weren't initialized yet.
+  static void require(const unsigned int& subsystems);
 
   inline static std::filesystem::path get_work_path() { return m_work_path; }
   inline static std::filesystem::path get_cache_path() {
@@ -51,4 +65,5 @@ private:
 
   static std::filesystem::path m_work_path;
   static nlohmann::json m_config;
+  static unsigned int m_ready_subsystems;
 };
@@ -17,6 +17,8 @@
 
 #include "location.hpp"
 
+#include <cmath>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <functional>
@@ -30,6 +32,8 @@
 
 #include "instanalyzer.hpp"
 #include "term.hpp"
+#include "timings.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
 
 using namespace std;
@@ -41,18 +45,40 @@ const map<Location::Geocoder, Location::GeocoderInfo> Location::m_geocoders = {
   }, getter_here}},
   {GEOCODER_YANDEX, {"#{red_out}Yandex", [] {
     return !string(YANDEX_API_KEY).empty();
-  }, getter_yandex}}
+  }, getter_yandex}},
+  {GEOCODER_MOCK, {"#{gray_out}Mock", [] {
+    return getenv("INSTANALYZER_MOCK_GEOCODER") != nullptr;
+  }, getter_mock}}
 };
 
-Location::Geocoder Location::m_geocoder;
+Location::Geocoder Location::m_geocoder = GEOCODER_NONE;
 
 void Location::init() {
-  if (Instanalyzer::get_pref("geocoder").empty()) {
-    set_geocoder(request_geocoder());
-    Instanalyzer::set_pref("geocoder", to_string(m_geocoder));
-  } else {
-    set_geocoder(static_cast<Geocoder>(stoi(Instanalyzer::get_pref("geocoder"))));
+  // Geocoder may be chosen already, e.g. by parameter.
+  if (m_geocoder != GEOCODER_NONE) {
+    return;
+  }
+
+  const string& pref = Instanalyzer::get_pref("geocoder");
+  Geocoder geocoder = GEOCODER_NONE;
+  try {
+    geocoder = static_cast<Geocoder>(stoi(pref));
+  } catch (const exception&) {}
+
+  // Saved geocoder may become unavailable (e.g. mock one without its
+  // environment variable), then it's chosen again.
+  const auto& info = m_geocoders.find(geocoder);
+  if (info != m_geocoders.cend() && info->second.checker()) {
+    set_geocoder(geocoder);
+    return;
+  }
+
+  if (geocoder != GEOCODER_NONE) {
+    Instanalyzer::msg(Instanalyzer::MSG_WARN,
+        "Saved geocoder isn't available, choose another one.");
   }
+  set_geocoder(request_geocoder());
+  Instanalyzer::set_pref("geocoder", to_string(m_geocoder));
 }
 
 Location::Geocoder Location::request_geocoder() {
@@ -98,7 +124,13 @@ Location::Geocoder Location::request_geocoder() {
 
 set<Location::Place> Location::get_common_places(
     const set<Location::Coord>& t_coords) {
-  if (t_coords.empty() || get_geocoder() == GEOCODER_NONE) {
+  const Trace::Scope trace("Location::get_common_places");
+  if (t_coords.empty()) {
+    return {};
+  }
+
+  Instanalyzer::require(Instanalyzer::SUB_GEOCODER);
+  if (get_geocoder() == GEOCODER_NONE) {
     return {};
   }
   return m_geocoders.at(get_geocoder()).getter(t_coords);
@@ -107,6 +139,7 @@ set<Location::Place> Location::get_common_places(
 set<Location::Place> Location::getter_here(
     const set<Location::Coord>& t_coords) {
   using namespace curlpp;
+  const Timings::Scope timing(Timings::PHASE_GEOCODING);
   cout << "\rReverse geocoding..." << flush;
 
   Easy request;
@@ -275,6 +308,7 @@ set<Location::Place> Location::getter_here_process(const json& t_json) {
 set<Location::Place> Location::getter_yandex(
     const set<Location::Coord>& t_coords) {
   using namespace filesystem;
+  const Timings::Scope timing(Timings::PHASE_GEOCODING);
 
   cout << Term::process_colors("For retrieving places info used geocoder by "
       "#{red_out}\u00a9 YANDEX, LLC#{reset}.") << endl;
@@ -388,8 +422,34 @@ set<Location::Place> Location::getter_yandex(
   return places;
 }
 
+set<Location::Place> Location::getter_mock(
+    const set<Location::Coord>& t_coords) {
+  const Timings::Scope timing(Timings::PHASE_GEOCODING);
+  set<Place> places;
+
+  // Every level of place is cell of grid, which becomes smaller
+  // with every next level.
+  const auto& get_cell = [] (const Coord& t_coord, const double& t_size) {
+    return to_string(static_cast<long>(floor(t_coord.lat / t_size))) + ':' +
+        to_string(static_cast<long>(floor(t_coord.lon / t_size)));
+  };
+
+  for (const auto& c : t_coords) {
+    Place place;
+    place.id = get_cell(c, 0.01);
+    place.accur = ACCUR_CITY;
+    place.country = "Country " + get_cell(c, 20.0);
+    place.state = "State " + get_cell(c, 5.0);
+    place.county = "County " + get_cell(c, 1.0);
+    place.city = "City " + get_cell(c, 0.1);
+    places.insert(place);
+  }
+  return places;
+}
+
 json Location::getter_yandex_download(const double& t_lat, const double& t_lon) {
   using namespace curlpp;
+  const Trace::Scope trace("Location::getter_yandex_download");
 
   Easy request;
   stringstream ss_json;
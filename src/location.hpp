@@ -28,7 +28,10 @@ public:
   enum Geocoder {
     GEOCODER_NONE = -1,
     GEOCODER_HERE,
-    GEOCODER_YANDEX
+    GEOCODER_YANDEX,
+    // Offline geocoder with generated places, available only if
+    // INSTANALYZER_MOCK_GEOCODER environment variable is set.
+    GEOCODER_MOCK
   };
 
   enum AccuracyLevel {
@@ -87,6 +90,7 @@ private:
   static std::set<Place> getter_here_process(const nlohmann::json&);
 
   static std::set<Place> getter_yandex(const std::set<Coord>&);
+  static std::set<Place> getter_mock(const std::set<Coord>&);
   static nlohmann::json getter_yandex_download(
       const double& lat, const double& lon);
 
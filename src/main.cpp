@@ -18,15 +18,12 @@
 #include <string>
 #include <vector>
 
-#include "curlpp/cURLpp.hpp"
-
 #include "instanalyzer.hpp"
 #include "params.hpp"
 
 using namespace std;
 
 int main(int argc, char* argv[]) {
-  curlpp::initialize();
   Instanalyzer::init();
 
   vector<string> params(argv + 1, argv + argc);
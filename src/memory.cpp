@@ -0,0 +1,153 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "memory.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace std;
+
+atomic<bool> Memory::m_is_enabled(false);
+atomic<uint64_t> Memory::m_allocs(0), Memory::m_bytes(0);
+atomic<int64_t> Memory::m_live(0), Memory::m_peak(0);
+
+void Memory::set_enabled(const bool& t_is_enabled) {
+  m_is_enabled.store(t_is_enabled, memory_order_relaxed);
+}
+
+Memory::Counters Memory::get_counters() {
+  return {m_allocs.load(memory_order_relaxed),
+      m_bytes.load(memory_order_relaxed), m_live.load(memory_order_relaxed)};
+}
+
+int64_t Memory::reset_peak() {
+  return m_peak.exchange(m_live.load(memory_order_relaxed),
+      memory_order_relaxed);
+}
+
+int64_t Memory::get_peak() {
+  return m_peak.load(memory_order_relaxed);
+}
+
+void Memory::merge_peak(const int64_t& t_peak) {
+  int64_t peak = m_peak.load(memory_order_relaxed);
+  while (peak < t_peak && !m_peak.compare_exchange_weak(
+      peak, t_peak, memory_order_relaxed)) {}
+}
+
+size_t Memory::get_rss() {
+  FILE* const statm = fopen("/proc/self/statm", "r");
+  if (statm == nullptr) {
+    return 0;
+  }
+
+  unsigned long pages = 0;
+  if (fscanf(statm, "%*u %lu", &pages) != 1) {
+    pages = 0;
+  }
+  fclose(statm);
+  return pages * sysconf(_SC_PAGESIZE);
+}
+
+size_t Memory::get_peak_rss() {
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  // In kilobytes on Linux.
+  return usage.ru_maxrss * 1024ul;
+}
+
+void Memory::on_alloc(void* t_ptr) {
+  const size_t size = malloc_usable_size(t_ptr);
+  m_allocs.fetch_add(1, memory_order_relaxed);
+  m_bytes.fetch_add(size, memory_order_relaxed);
+  merge_peak(m_live.fetch_add(size, memory_order_relaxed) + size);
+}
+
+void Memory::on_free(void* t_ptr) {
+  m_live.fetch_sub(malloc_usable_size(t_ptr), memory_order_relaxed);
+}
+
+// Replacements of global allocation functions. Aligned variants
+// aren't replaced, so overaligned objects aren't counted.
+
+void* operator new(size_t t_size) {
+  void* ptr;
+  // New handler may free some memory, so allocation is repeated until
+  // it's removed.
+  while ((ptr = malloc(t_size != 0 ? t_size : 1)) == nullptr) {
+    const new_handler handler = get_new_handler();
+    if (handler == nullptr) {
+      throw bad_alloc();
+    }
+    handler();
+  }
+  if (Memory::is_enabled()) {
+    Memory::on_alloc(ptr);
+  }
+  return ptr;
+}
+
+void* operator new[](size_t t_size) {
+  return operator new(t_size);
+}
+
+void* operator new(size_t t_size, const nothrow_t&) noexcept {
+  try {
+    return operator new(t_size);
+  } catch (const bad_alloc&) {
+    return nullptr;
+  }
+}
+
+void* operator new[](size_t t_size, const nothrow_t&) noexcept {
+  return operator new(t_size, nothrow);
+}
+
+void operator delete(void* t_ptr) noexcept {
+  if (t_ptr != nullptr && Memory::is_enabled()) {
+    Memory::on_free(t_ptr);
+  }
+  free(t_ptr);
+}
+
+void operator delete[](void* t_ptr) noexcept {
+  operator delete(t_ptr);
+}
+
+void operator delete(void* t_ptr, size_t) noexcept {
+  operator delete(t_ptr);
+}
+
+void operator delete[](void* t_ptr, size_t) noexcept {
+  operator delete(t_ptr);
+}
+
+void operator delete(void* t_ptr, const nothrow_t&) noexcept {
+  operator delete(t_ptr);
+}
+
+void operator delete[](void* t_ptr, const nothrow_t&) noexcept {
+  operator delete(t_ptr);
+}
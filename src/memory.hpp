@@ -0,0 +1,57 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Accounting of heap allocations through replaced global operators
+// "new" and "delete". While disabled, operators only check flag.
+class Memory {
+public:
+  struct Counters {
+    std::uint64_t allocs, bytes;
+    // May be negative, if memory allocated before enabling is freed.
+    std::int64_t live;
+  };
+
+  static void set_enabled(const bool&);
+  inline static bool is_enabled() {
+    return m_is_enabled.load(std::memory_order_relaxed);
+  }
+
+  static Counters get_counters();
+  // Start new measure of peak, returns previous peak of live bytes.
+  static std::int64_t reset_peak();
+  static std::int64_t get_peak();
+  // Restore peak after nested measure.
+  static void merge_peak(const std::int64_t&);
+
+  // Resident set size of this process in bytes, current and peak.
+  static std::size_t get_rss();
+  static std::size_t get_peak_rss();
+
+  static void on_alloc(void*);
+  static void on_free(void*);
+
+private:
+  static std::atomic<bool> m_is_enabled;
+  static std::atomic<std::uint64_t> m_allocs, m_bytes;
+  static std::atomic<std::int64_t> m_live, m_peak;
+};
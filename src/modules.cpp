@@ -17,18 +17,33 @@
 
 #include "modules.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <list>
 #include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <sys/stat.h>
+#include <zip.h>
 
 #include "boost/process.hpp"
 #include "boost/regex.hpp"
 #include "curlpp/Easy.hpp"
+#include "curlpp/Infos.hpp"
 #include "curlpp/Options.hpp"
-#include "libzippp.h"
+#include "nlohmann/json.hpp"
 
+#include "reactor.hpp"
 #include "term.hpp"
+#include "timings.hpp"
+#include "trace.hpp"
+#include "utils.hpp"
 
+using namespace nlohmann;
 using namespace std;
 
 const vector<Modules::ZipModuleInfo> Modules::m_zip_modules = {
@@ -67,11 +82,85 @@ const vector<Modules::ZipModuleInfo> Modules::m_zip_modules = {
   }
 };
 
+const string Modules::m_replay_script = R"(# Replay of recorded session of Instaloader.
+# Arguments: <session> <speed> <arguments of Instaloader>.
+# Session is directory with "session.ndjson" and "files" directory.
+# Subdirectory of session named by target is used instead, if it exists.
+# Every line of "session.ndjson" is event with optional "delay"
+# (milliseconds after previous event) and one of fields:
+#   "out", "err" - line printed to stdout or stderr;
+#   "file" - name of file copied from "files" to directory of profile;
+#   "exit" - exit code of process.
+import json
+import os
+import shutil
+import sys
+import time
+
+
+def main():
+    session, speed = sys.argv[1], float(sys.argv[2])
+    target = sys.argv[-1]
+    dirname = target
+    for arg in sys.argv[3:]:
+        if arg.startswith('--dirname-pattern='):
+            dirname = arg[len('--dirname-pattern='):]
+    dirname = dirname.replace('{target}', target)
+    os.makedirs(dirname, exist_ok=True)
+    if os.path.isfile(os.path.join(session, target, 'session.ndjson')):
+        session = os.path.join(session, target)
+
+    code = 0
+    with open(os.path.join(session, 'session.ndjson')) as events:
+        for line in events:
+            if not line.strip():
+                continue
+            event = json.loads(line)
+
+            delay = event.get('delay', 0)
+            if speed > 0 and delay > 0:
+                time.sleep(delay / 1000.0 / speed)
+
+            if 'out' in event:
+                sys.stdout.write(event['out'] + '\n')
+                sys.stdout.flush()
+            elif 'err' in event:
+                sys.stderr.write(event['err'] + '\n')
+                sys.stderr.flush()
+            elif 'file' in event:
+                shutil.copyfile(os.path.join(session, 'files', event['file']),
+                                os.path.join(dirname, event['file']))
+            elif 'exit' in event:
+                code = event['exit']
+    sys.exit(code)
+
+
+main()
+)";
+
 filesystem::path Modules::m_interpreter_path;
 
 void Modules::init_interpreter() {
   using namespace boost::process;
 
+  if (!m_interpreter_path.empty()) {
+    return;
+  }
+
+  // Use previously found interpreter if its file didn't change since then.
+  const string& cached_path = Instanalyzer::get_pref("python_path");
+  if (!cached_path.empty() &&
+      !Instanalyzer::get_pref("python_version").empty()) {
+    const auto& stamp = get_file_stamp(cached_path);
+
+    if (stamp.first != 0 &&
+        to_string(stamp.first) == Instanalyzer::get_pref("python_mtime") &&
+        to_string(stamp.second) == Instanalyzer::get_pref("python_inode")) {
+      m_interpreter_path = cached_path;
+      return;
+    }
+  }
+
   const vector<string> names = {
     "python3.7", "python3.7m", "python3.6", "python3.6m",
     "python3.5", "python3.5m", "python3", "python3m"
@@ -112,6 +201,12 @@ void Modules::init_interpreter() {
 
         if (boost::regex_match(output, match, python_ver)) {
           m_interpreter_path = p / n;
+          const auto& stamp = get_file_stamp(m_interpreter_path);
+
+          Instanalyzer::set_pref("python_path", m_interpreter_path);
+          Instanalyzer::set_pref("python_version", output);
+          Instanalyzer::set_pref("python_mtime", to_string(stamp.first));
+          Instanalyzer::set_pref("python_inode", to_string(stamp.second));
           return;
         }
       }
@@ -121,110 +216,481 @@ void Modules::init_interpreter() {
       "version #{bold}3.5#{reset} didn't find! Please, install it."));
 }
 
+pair<time_t, ino_t> Modules::get_file_stamp(const filesystem::path& t_path) {
+  struct stat st;
+  if (stat(t_path.c_str(), &st) != 0) {
+    return {0, 0};
+  }
+  return {st.st_mtime, st.st_ino};
+}
+
+string Modules::get_instaloader_version() {
+  ifstream ifs(get_modules_path() / "instaloader" / "__init__.py");
+  const string& key = "__version__";
+  string line;
+
+  while (getline(ifs, line)) {
+    if (line.compare(0, key.size(), key) != 0) {
+      continue;
+    }
+
+    const size_t begin = line.find_first_of("'\"");
+    const size_t end = begin == string::npos ?
+        string::npos : line.find(line[begin], begin + 1);
+    if (end != string::npos) {
+      return line.substr(begin + 1, end - begin - 1);
+    }
+  }
+  return "";
+}
+
+string Modules::get_instaloader_command() {
+  if (!is_replay()) {
+    return get_instaloader_path();
+  }
+
+  // Script is written once per run, because other processes of batch
+  // may be reading it.
+  static bool is_script_written = false;
+  if (!is_script_written) {
+    filesystem::create_directories(get_modules_path());
+    Utils::write_file(get_replay_script_path(), m_replay_script);
+    is_script_written = true;
+  }
+
+  // Paths are quoted, because they may contain spaces.
+  const char* speed = getenv("INSTANALYZER_REPLAY_SPEED");
+  return '"' + string(get_replay_script_path()) + "\" \"" +
+      getenv("INSTANALYZER_REPLAY") + "\" " + (speed != nullptr ? speed : "1");
+}
+
+shared_ptr<Modules::Recorder> Modules::start_record(const string& t_params) {
+  using namespace filesystem;
+  if (!is_record()) {
+    return nullptr;
+  }
+
+  // Target is last parameter, its directory is set by pattern.
+  const string& target = t_params.substr(t_params.rfind(' ') + 1);
+  const string& pattern = "--dirname-pattern=";
+  const size_t begin = t_params.find(pattern);
+  string dirname = begin == string::npos ? target : t_params.substr(
+      begin + pattern.size(), t_params.find(' ', begin) - begin -
+      pattern.size());
+  for (size_t p = dirname.find("{target}"); p != string::npos;
+      p = dirname.find("{target}", p + target.size())) {
+    dirname.replace(p, string("{target}").size(), target);
+  }
+
+  const auto& recorder = make_shared<Recorder>();
+  recorder->session = path(getenv("INSTANALYZER_RECORD")) / target;
+  recorder->dirname = dirname;
+
+  error_code e;
+  remove_all(recorder->session, e);
+  create_directories(recorder->session / "files", e);
+  recorder->events.open(recorder->session / "session.ndjson");
+  if (!recorder->events) {
+    throw runtime_error("Session (" + recorder->session.string() +
+        ") didn't create!");
+  }
+
+  for (const auto& f : directory_iterator(dirname, e)) {
+    if (f.is_regular_file()) {
+      recorder->files[f.path().filename()] = f.last_write_time();
+    }
+  }
+  recorder->last = chrono::steady_clock::now();
+  return recorder;
+}
+
+void Modules::record_line(Recorder& t_recorder, const string& t_stream,
+    const string& t_line) {
+  using namespace chrono;
+  const auto& now = steady_clock::now();
+  t_recorder.events << json({
+    {"delay", duration_cast<milliseconds>(now - t_recorder.last).count()},
+    {t_stream, t_line}
+  }) << '\n';
+  t_recorder.last = now;
+}
+
+void Modules::finish_record(Recorder& t_recorder, const int& t_code) {
+  using namespace chrono;
+  using namespace filesystem;
+  const auto& delay = duration_cast<milliseconds>(steady_clock::now() -
+      t_recorder.last).count();
+
+  // New and changed files are found by modification time.
+  error_code e;
+  for (const auto& f : directory_iterator(t_recorder.dirname, e)) {
+    const string& name = f.path().filename();
+    const auto& old = t_recorder.files.find(name);
+    if (!f.is_regular_file() || (old != t_recorder.files.cend() &&
+        old->second == f.last_write_time())) {
+      continue;
+    }
+
+    error_code copy_e;
+    copy_file(f.path(), t_recorder.session / "files" / name,
+        copy_options::overwrite_existing, copy_e);
+    if (!copy_e) {
+      t_recorder.events << json({{"file", name}}) << '\n';
+    }
+  }
+
+  t_recorder.events << json({{"delay", delay}, {"exit", t_code}}) << '\n';
+  t_recorder.events.close();
+}
+
 void Modules::update_modules() {
-  using namespace curlpp;
   using namespace filesystem;
-  using namespace libzippp;
+  const Trace::Scope trace("Modules::update_modules");
 
+  Instanalyzer::require(Instanalyzer::SUB_NETWORK);
   cout << "Updating modules..." << endl;
 
-  try {
-    remove_all(get_modules_path());
-  } catch (const exception&) {}
-
-  if (!create_directory(get_modules_path())) {
+  if (!directory_entry(get_modules_path()).exists() &&
+      !create_directory(get_modules_path())) {
     throw runtime_error("Parent directory for modules (" +
         string(get_modules_path()) + ") didn't create!");
   }
 
-  for (const auto& m : m_zip_modules) {
-    cout << Term::process_colors(
-        "  #{gray_out}" + m.name + "\n\r#{reset}#{bold}Downloading...") << flush;
-    const path& archive_path = Instanalyzer::get_tmp_prefix() + m.name + ".zip";
+  cout << Term::process_colors("\r#{bold}Downloading...#{reset}") << flush;
+  vector<Download> downloads(m_zip_modules.size());
+  vector<exception_ptr> errors(m_zip_modules.size());
+  vector<thread> downloaders;
+
+  for (size_t i = 0; i < m_zip_modules.size(); ++i) {
+    const auto& m = m_zip_modules[i];
+    // Validators are sent only for installed modules, because others
+    // are extracted anyway.
+    const string& pref = "module_" + m.name;
+    const bool is_inst = is_installed(m);
+    const string& etag = is_inst ? Instanalyzer::get_pref(pref + "_etag") : "";
+    const string& modified =
+        is_inst ? Instanalyzer::get_pref(pref + "_modified") : "";
+
+    downloaders.emplace_back([i, etag, modified, &downloads, &errors] {
+      try {
+        downloads[i] = download_archive(m_zip_modules[i].url, etag, modified);
+      } catch (...) {
+        errors[i] = current_exception();
+      }
+    });
+  }
+  for (auto& d : downloaders) {
+    d.join();
+  }
+  cout << Term::clear_line() << flush;
+
+  for (size_t i = 0; i < m_zip_modules.size(); ++i) {
+    const auto& m = m_zip_modules[i];
+    if (errors[i] != nullptr) {
+      rethrow_exception(errors[i]);
+    }
+
+    const string& pref = "module_" + m.name;
+    const Download& d = downloads[i];
+    const string& checksum = d.is_modified ?
+        to_string(Utils::get_checksum(d.archive)) : "";
+
+    if (!d.is_modified ||
+        (is_installed(m) && Instanalyzer::get_pref(pref) == checksum)) {
+      cout << Term::process_colors("  #{gray_out}" + m.name +
+          " (unchanged)#{reset}") << endl;
+    } else {
+      cout << Term::process_colors("  #{gray_out}" + m.name +
+          "\n\r#{reset}#{bold}Extracting...") << flush;
+      extract_archive(d.archive, m);
+      Instanalyzer::set_pref(pref, checksum);
+      cout << Term::clear_line() << flush;
+    }
+
+    if (d.is_modified) {
+      Instanalyzer::set_pref(pref + "_etag", d.etag);
+      Instanalyzer::set_pref(pref + "_modified", d.modified);
+    }
+  }
+  cout << "All done." << endl;
+}
+
+bool Modules::is_installed(const ZipModuleInfo& t_module) {
+  using namespace filesystem;
 
-    try {
-      remove(archive_path);
-    } catch (const exception&) {}
+  for (const auto& p : t_module.paths) {
+    if (!directory_entry(get_modules_path() /
+        p.substr(p.find_last_of('/') + 1)).exists()) {
+      return false;
+    }
+  }
+  return true;
+}
 
-    ofstream archive(archive_path);
-    options::WriteStream ws(&archive);
-    Easy request;
+Modules::Download Modules::download_archive(const string& t_url,
+    const string& t_etag, const string& t_modified) {
+  using namespace curlpp;
+  const Trace::Scope trace("Modules::download_archive");
 
-    request.setOpt(options::Url(m.url));
-    request.setOpt(options::WriteStream(ws));
-    request.setOpt(options::FollowLocation(1));
-    request.setOpt(options::UserAgent("instanalyzer"));
+  ostringstream archive;
+  Download download = {"", "", "", true};
+  Easy request;
 
-    request.perform();
-    archive.close();
+  list<string> headers;
+  if (!t_etag.empty()) {
+    headers.push_back("If-None-Match: " + t_etag);
+  }
+  if (!t_modified.empty()) {
+    headers.push_back("If-Modified-Since: " + t_modified);
+  }
 
-    cout << Term::clear_line() + Term::process_colors("#{bold}Extracting...") <<
-        flush;
-    ZipArchive za(archive_path);
-    za.open();
+  request.setOpt(options::Url(t_url));
+  request.setOpt(options::WriteStream(&archive));
+  request.setOpt(options::FollowLocation(1));
+  request.setOpt(options::UserAgent("instanalyzer"));
+  request.setOpt(options::HttpHeader(headers));
+  // Headers of every response in chain of redirects are passed, so
+  // validators are reset by status line of next response.
+  const auto& read_header = [&download] (char* data, size_t size,
+      size_t count) {
+    const string line(data, size * count);
+    const size_t colon = line.find(':');
+
+    if (line.rfind("HTTP/", 0) == 0) {
+      download.etag.clear();
+      download.modified.clear();
+    } else if (colon != string::npos) {
+      string name = line.substr(0, colon);
+      transform(name.begin(), name.end(), name.begin(), ::tolower);
+      const size_t begin = line.find_first_not_of(" \t", colon + 1);
+      const size_t end = line.find_last_not_of(" \t\r\n");
+      const string& value = begin == string::npos || end < begin ?
+          "" : line.substr(begin, end - begin + 1);
+
+      if (name == "etag") {
+        download.etag = value;
+      } else if (name == "last-modified") {
+        download.modified = value;
+      }
+    }
+    return size * count;
+  };
+  request.setOpt(options::HeaderFunction(read_header));
+
+  request.perform();
+  const long response_code = infos::ResponseCode::get(request);
+  if (response_code == 304) {
+    download.is_modified = false;
+  } else if (response_code != 200) {
+    throw runtime_error("Archive (" + t_url + ") didn't download: HTTP " +
+        to_string(response_code) + '.');
+  } else {
+    download.archive = archive.str();
+  }
+  return download;
+}
 
-    if (za.getEntriesCount() == 0) {
-      throw runtime_error(
-          "Archive \"" + string(archive_path) + "\" doesn't contain any entry!");
+void Modules::extract_archive(
+    const string& t_archive, const ZipModuleInfo& t_module) {
+  using namespace filesystem;
+  const Trace::Scope trace("Modules::extract_archive");
+
+  // Lookup table of paths in archive and their names in modules directory.
+  unordered_map<string_view, string> targets;
+  for (const auto& p : t_module.paths) {
+    targets.emplace(p, p.substr(p.find_last_of('/') + 1));
+    remove_all(get_modules_path() / targets.at(p));
+  }
+
+  zip_error_t error;
+  zip_error_init(&error);
+  zip_source_t* source = zip_source_buffer_create(
+      t_archive.data(), t_archive.size(), 0, &error);
+  zip_t* archive = source == nullptr ?
+      nullptr : zip_open_from_source(source, ZIP_RDONLY, &error);
+
+  if (archive == nullptr) {
+    if (source != nullptr) {
+      zip_source_free(source);
     }
+    const string& err = zip_error_strerror(&error);
+    zip_error_fini(&error);
+    throw runtime_error("Archive of \"" + t_module.name +
+        "\" didn't open: " + err + '.');
+  }
+  zip_error_fini(&error);
 
-    const auto& entries = za.getEntries();
-    for (const auto& e : entries) {
-      for (const auto& p : m.paths) {
-        if (e.getName().substr(0, p.size()) != p) {
-          continue;
-        }
+  const zip_int64_t entries_count = zip_get_num_entries(archive, 0);
+  if (entries_count <= 0) {
+    zip_discard(archive);
+    throw runtime_error(
+        "Archive of \"" + t_module.name + "\" doesn't contain any entry!");
+  }
 
-        path target_path = get_modules_path() / p.substr(p.find_last_of('/') + 1);
-        const string& target_child = e.getName().substr(p.size());
+  string content;
+  for (zip_int64_t i = 0; i < entries_count; ++i) {
+    const char* entry_name = zip_get_name(archive, i, 0);
+    if (entry_name == nullptr) {
+      continue;
+    }
 
-        if (target_child.size() > 1) {
-          // Skip first slash character.
-          target_path =
-              target_path / target_child.substr(1);
-        }
+    // Check every parent directory of entry (and entry itself) in table.
+    const string_view name(entry_name);
+    path target_path;
 
-        if (e.isDirectory()) {
-          if (!directory_entry(target_path).exists() &&
-              !create_directory(target_path)) {
-            throw runtime_error(
-                "Child directory \"" + string(target_path) + "\" didn't create!");
-          }
-        } else {
-          ofstream ofs(target_path);
-          e.readContent(ofs);
+    for (size_t pos = name.find('/');; pos = name.find('/', pos + 1)) {
+      const auto& target = targets.find(name.substr(0, pos));
+      if (target != targets.end()) {
+        target_path = get_modules_path() / target->second;
+        if (pos != string_view::npos && pos + 1 < name.size()) {
+          target_path /= name.substr(pos + 1);
         }
+        break;
+      } else if (pos == string_view::npos) {
+        break;
       }
     }
-    remove(archive_path);
-    cout << Term::clear_line() << flush;
+
+    if (target_path.empty()) {
+      continue;
+    }
+    // Entry with parent components could be written outside of modules.
+    const path& relative = target_path.lexically_normal().lexically_relative(
+        get_modules_path().lexically_normal());
+    if (relative.empty() || *relative.begin() == "..") {
+      zip_discard(archive);
+      throw runtime_error("Entry \"" + string(name) + "\" of \"" +
+          t_module.name + "\" is outside of modules directory!");
+    }
+
+    if (name.back() == '/') {
+      create_directories(target_path);
+      continue;
+    }
+
+    zip_stat_t stat;
+    zip_file_t* file = nullptr;
+
+    if (zip_stat_index(archive, i, 0, &stat) == 0 &&
+        (stat.valid & ZIP_STAT_SIZE) != 0) {
+      file = zip_fopen_index(archive, i, 0);
+    }
+    if (file == nullptr) {
+      zip_discard(archive);
+      throw runtime_error("Entry \"" + string(name) + "\" didn't read!");
+    }
+
+    content.resize(stat.size);
+    const zip_int64_t read = zip_fread(file, content.data(), stat.size);
+    zip_fclose(file);
+
+    if (read < 0 || static_cast<zip_uint64_t>(read) != stat.size) {
+      zip_discard(archive);
+      throw runtime_error("Entry \"" + string(name) + "\" didn't read!");
+    }
+
+    create_directories(target_path.parent_path());
+    ofstream ofs(target_path, ios::binary);
+    ofs.write(content.data(), content.size());
   }
-  cout << "All done." << endl;
+  zip_discard(archive);
 }
 
-void Modules::interpreter(const string& t_params,
-    const Modules::parser_cb t_cb_out, const Modules::parser_cb t_cb_err) {
-  using namespace boost::process;
+int Modules::interpreter(const string& t_params,
+    const Modules::parser_cb& t_cb_out, const Modules::parser_cb& t_cb_err) {
+  const Timings::Scope timing(Timings::PHASE_INTERPRETER);
+  bool is_finished = false;
+  int code = EXIT_FAILURE;
+
+  try {
+    init_interpreter();
+    Reactor::spawn(string(m_interpreter_path) + ' ' + t_params, t_cb_out,
+        t_cb_err, [&is_finished, &code] (const int t_code) {
+      is_finished = true;
+      code = t_code;
+    });
+
+    while (!is_finished) {
+      Reactor::run_once();
+    }
+  } catch (const exception& e) {
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, e.what());
+    exit(EXIT_FAILURE);
+  }
+  return code;
+}
+
+void Modules::instaloader(const string& t_params,
+    const parser_cb& t_cb_out, const parser_cb& t_cb_err) {
+  Instanalyzer::require(Instanalyzer::SUB_MODULES);
+  string command;
+  shared_ptr<Recorder> recorder;
+
+  try {
+    command = get_instaloader_command();
+    recorder = start_record(t_params);
+  } catch (const exception& e) {
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, e.what());
+    exit(EXIT_FAILURE);
+  }
 
-  ipstream out_pstream, err_pstream;
-  const string& exec = string(m_interpreter_path) + ' ' + t_params;
-  child c(exec, std_out > out_pstream, std_err > err_pstream);
+  if (recorder == nullptr) {
+    interpreter(command + ' ' + t_params, t_cb_out, t_cb_err);
+    return;
+  }
 
-  thread out_reader([&out_pstream,&t_cb_out] {
-    string line;
-    while (getline(out_pstream, line) && t_cb_out != nullptr) {
-      t_cb_out(line);
+  const int code = interpreter(command + ' ' + t_params,
+      [&recorder, &t_cb_out] (const string& t_line) {
+    record_line(*recorder, "out", t_line);
+    if (t_cb_out != nullptr) {
+      t_cb_out(t_line);
+    }
+  }, [&recorder, &t_cb_err] (const string& t_line) {
+    record_line(*recorder, "err", t_line);
+    if (t_cb_err != nullptr) {
+      t_cb_err(t_line);
     }
   });
+  finish_record(*recorder, code);
+}
+
+void Modules::instaloader_async(const string& t_params,
+    const parser_cb& t_cb_out, const parser_cb& t_cb_err,
+    const function<void(const int)>& t_cb_exit) {
+  Instanalyzer::require(Instanalyzer::SUB_MODULES);
+  const string& command = get_instaloader_command() + ' ' + t_params;
+  const shared_ptr<Recorder>& recorder = start_record(t_params);
+
+  if (recorder == nullptr) {
+    interpreter_async(command, t_cb_out, t_cb_err, t_cb_exit);
+    return;
+  }
 
-  thread err_reader([&err_pstream,&t_cb_err] {
-    string line;
-    while (getline(err_pstream, line) && t_cb_err != nullptr) {
-      t_cb_err(line);
+  interpreter_async(command, [recorder, t_cb_out] (const string& t_line) {
+    record_line(*recorder, "out", t_line);
+    if (t_cb_out != nullptr) {
+      t_cb_out(t_line);
     }
+  }, [recorder, t_cb_err] (const string& t_line) {
+    record_line(*recorder, "err", t_line);
+    if (t_cb_err != nullptr) {
+      t_cb_err(t_line);
+    }
+  }, [recorder, t_cb_exit] (const int t_code) {
+    finish_record(*recorder, t_code);
+    t_cb_exit(t_code);
   });
+}
 
-  c.wait();
-  out_reader.join();
-  err_reader.join();
+void Modules::interpreter_async(const string& t_params,
+    const parser_cb& t_cb_out, const parser_cb& t_cb_err,
+    const function<void(const int)>& t_cb_exit) {
+  init_interpreter();
+  // Lifetime of process is traced, because it overlaps with others.
+  const unsigned long trace_id = Trace::begin_async("Modules::process");
+  Reactor::spawn(string(m_interpreter_path) + ' ' + t_params,
+      t_cb_out, t_cb_err, [t_cb_exit, trace_id] (const int t_code) {
+    Trace::end_async("Modules::process", trace_id);
+    t_cb_exit(t_code);
+  });
 }
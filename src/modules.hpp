@@ -17,34 +17,71 @@
 
 #pragma once
 
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
 #include <vector>
 #include <string>
+#include <utility>
+
+#include <sys/types.h>
 
 #include "instanalyzer.hpp"
 
 class Modules {
 public:
   // Callback for parsing output.
-  typedef void (*parser_cb)(const std::string&);
+  typedef std::function<void(const std::string&)> parser_cb;
 
   struct ZipModuleInfo {
     std::string name, url;
     std::vector<std::string> paths;
   };
 
+  // Find Python interpreter. Result is cached in config and rechecked
+  // only when modification time or inode of interpreter file changed.
   static void init_interpreter() noexcept(false);
+  // Download all modules concurrently and extract only those
+  // which checksum of archive differs from previously installed.
+  // Requests of installed modules are conditional, so unchanged
+  // archives aren't downloaded again.
   static void update_modules() noexcept(false);
 
-  static void interpreter(const std::string& params,
-      const parser_cb cb_out = nullptr, const parser_cb cb_err = nullptr);
+  // Interpreter is initialized on first call. Output is dispatched
+  // by Reactor, so other running processes are also served while waiting.
+  // Return exit code of process.
+  static int interpreter(const std::string& params,
+      const parser_cb& cb_out = nullptr, const parser_cb& cb_err = nullptr);
 
-  inline static void instaloader(const std::string& t_params,
-      const parser_cb t_cb_out = nullptr, const parser_cb t_cb_err = nullptr) {
-    interpreter(std::string(get_instaloader_path()) + ' ' + t_params,
-        t_cb_out, t_cb_err);
-  }
+  static void instaloader(const std::string& params,
+      const parser_cb& cb_out = nullptr, const parser_cb& cb_err = nullptr);
+
+  // Start interpreter without waiting for it. Callbacks (including
+  // "cb_exit" with exit code) are called while Reactor dispatches events.
+  static void interpreter_async(const std::string& params,
+      const parser_cb& cb_out, const parser_cb& cb_err,
+      const std::function<void(const int)>& cb_exit) noexcept(false);
+
+  static void instaloader_async(const std::string& params,
+      const parser_cb& cb_out, const parser_cb& cb_err,
+      const std::function<void(const int)>& cb_exit) noexcept(false);
 
+  inline static std::filesystem::path get_interpreter_path() noexcept(false) {
+    init_interpreter();
+    return m_interpreter_path;
+  }
+  // Output of "python --version", cached together with interpreter path.
+  inline static std::string get_interpreter_version() noexcept(false) {
+    init_interpreter();
+    return Instanalyzer::get_pref("python_version");
+  }
+  // Read from sources of installed module, empty if it isn't installed.
+  static std::string get_instaloader_version();
   inline static std::filesystem::path get_modules_path() {
     return Instanalyzer::get_work_path() / "modules";
   }
@@ -52,7 +89,62 @@ public:
     return get_modules_path() / "instaloader.py";
   }
 
+  // Instaloader is replaced by script, which replays recorded session
+  // (output lines with delays and written files) from directory in
+  // INSTANALYZER_REPLAY. Delays are divided by INSTANALYZER_REPLAY_SPEED
+  // (1 by default, 0 disables them). Format of session is described
+  // in the script.
+  inline static bool is_replay() {
+    return getenv("INSTANALYZER_REPLAY") != nullptr;
+  }
+  inline static std::filesystem::path get_replay_script_path() {
+    return get_modules_path() / "instanalyzer_replay.py";
+  }
+  // Every run of Instaloader is recorded as session to subdirectory
+  // (named by target) of directory in INSTANALYZER_RECORD. Replay uses
+  // such subdirectory, if it exists. Files written by Instaloader are
+  // recorded at end of session.
+  inline static bool is_record() {
+    return getenv("INSTANALYZER_RECORD") != nullptr && !is_replay();
+  }
+
 private:
+  struct Recorder {
+    std::filesystem::path session, dirname;
+    std::ofstream events;
+    std::chrono::steady_clock::time_point last;
+    // Files of profile with modification times before session.
+    std::map<std::string, std::filesystem::file_time_type> files;
+  };
+
+  // Script of Instaloader or of replay with its arguments.
+  static std::string get_instaloader_command() noexcept(false);
+  // Start recording of Instaloader with parameters, if it's enabled.
+  static std::shared_ptr<Recorder> start_record(const std::string& params)
+      noexcept(false);
+  static void record_line(Recorder&, const std::string& stream,
+      const std::string& line);
+  static void finish_record(Recorder&, const int& code);
+  // Archive with validators of its version (ETag and Last-Modified).
+  struct Download {
+    std::string archive, etag, modified;
+    bool is_modified;
+  };
+
+  // Whether all paths of module exist in modules directory.
+  static bool is_installed(const ZipModuleInfo&);
+  // Request is conditional with validators of previous download, if
+  // they are passed. Archive isn't returned, if it wasn't modified.
+  static Download download_archive(const std::string& url,
+      const std::string& etag, const std::string& modified) noexcept(false);
+  static void extract_archive(const std::string& archive,
+      const ZipModuleInfo&) noexcept(false);
+
+  // Return modification time and inode of file, or zeros on error.
+  static std::pair<std::time_t, ino_t> get_file_stamp(
+      const std::filesystem::path&);
+
   static const std::vector<ZipModuleInfo> m_zip_modules;
+  static const std::string m_replay_script;
   static std::filesystem::path m_interpreter_path;
 };
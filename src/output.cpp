@@ -0,0 +1,183 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "output.hpp"
+
+#include <cstdio>
+#include <iostream>
+#include <map>
+
+using namespace std;
+
+const size_t Output::FLUSH_SIZE = 64 * 1024;
+
+Output::Format Output::m_format = FMT_TABLE;
+unique_ptr<ostream> Output::m_out;
+string Output::m_report;
+vector<string> Output::m_columns;
+string Output::m_buffer;
+bool Output::m_is_first_report = true;
+
+bool Output::set_format(const string& t_name) {
+  static const map<string, Format> formats = {
+    {"table", FMT_TABLE}, {"ndjson", FMT_NDJSON}, {"csv", FMT_CSV}
+  };
+
+  const auto& format = formats.find(t_name);
+  if (format == formats.end()) {
+    return false;
+  }
+  m_format = format->second;
+
+  if (is_machine() && m_out == nullptr) {
+    // Keep stdout for records, other output goes to stderr.
+    m_out = make_unique<ostream>(cout.rdbuf());
+    cout.rdbuf(cerr.rdbuf());
+  }
+  return true;
+}
+
+void Output::begin_report(const string& t_name,
+    const vector<string>& t_columns) {
+  end_report();
+  m_report = t_name;
+  m_columns = t_columns;
+
+  if (m_format != FMT_CSV) {
+    return;
+  }
+
+  // Tables of different reports separated by empty line.
+  if (!m_is_first_report) {
+    m_buffer += '\n';
+  }
+  m_is_first_report = false;
+
+  for (size_t i = 0; i < m_columns.size(); ++i) {
+    if (i != 0) {
+      m_buffer += ',';
+    }
+    append_csv_field(Value(m_columns[i]));
+  }
+  m_buffer += '\n';
+}
+
+void Output::write_record(initializer_list<Value> t_values) {
+  write_record(t_values.begin(), t_values.end());
+}
+
+void Output::write_record(const vector<Value>& t_values) {
+  write_record(t_values.data(), t_values.data() + t_values.size());
+}
+
+void Output::write_record(const Value* t_begin, const Value* t_end) {
+  if (m_format == FMT_NDJSON) {
+    m_buffer += "{\"report\":";
+    append_json_string(m_report);
+
+    for (size_t i = 0; t_begin + i != t_end && i < m_columns.size(); ++i) {
+      m_buffer += ',';
+      append_json_string(m_columns[i]);
+      m_buffer += ':';
+
+      if (t_begin[i].is_string) {
+        append_json_string(t_begin[i].str);
+      } else {
+        m_buffer += t_begin[i].str;
+      }
+    }
+    m_buffer += "}\n";
+  } else if (m_format == FMT_CSV) {
+    for (const Value* v = t_begin; v != t_end; ++v) {
+      if (v != t_begin) {
+        m_buffer += ',';
+      }
+      append_csv_field(*v);
+    }
+    m_buffer += '\n';
+  }
+
+  if (m_buffer.size() >= FLUSH_SIZE) {
+    m_out->write(m_buffer.data(), m_buffer.size());
+    m_buffer.clear();
+  }
+}
+
+void Output::end_report() {
+  if (m_out == nullptr) {
+    return;
+  }
+
+  m_out->write(m_buffer.data(), m_buffer.size());
+  m_out->flush();
+  m_buffer.clear();
+}
+
+string Output::format_double(const double& t_val) {
+  char str[32];
+  snprintf(str, sizeof(str), "%.6g", t_val);
+  return str;
+}
+
+void Output::append_json_string(const string& t_str) {
+  m_buffer += '"';
+
+  for (const auto& c : t_str) {
+    switch (c) {
+      case '"':
+        m_buffer += "\\\"";
+        break;
+      case '\\':
+        m_buffer += "\\\\";
+        break;
+      case '\n':
+        m_buffer += "\\n";
+        break;
+      case '\r':
+        m_buffer += "\\r";
+        break;
+      case '\t':
+        m_buffer += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          m_buffer += escaped;
+        } else {
+          m_buffer += c;
+        }
+    }
+  }
+  m_buffer += '"';
+}
+
+void Output::append_csv_field(const Value& t_val) {
+  if (t_val.str.find_first_of(",\"\r\n") == string::npos) {
+    m_buffer += t_val.str;
+    return;
+  }
+
+  m_buffer += '"';
+  for (const auto& c : t_val.str) {
+    if (c == '"') {
+      m_buffer += '"';
+    }
+    m_buffer += c;
+  }
+  m_buffer += '"';
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <initializer_list>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Backend for machine-readable output of analyses. In NDJSON and CSV formats
+// records are written to stdout as they are produced, whereas all other
+// output (progress, messages) redirected to stderr.
+class Output {
+public:
+  enum Format {
+    FMT_TABLE,
+    FMT_NDJSON,
+    FMT_CSV
+  };
+
+  // Field of record, formatted once on construction.
+  struct Value {
+    Value(const std::string_view& t_str): str(t_str), is_string(true) {}
+    Value(const char* t_str): Value(std::string_view(t_str)) {}
+    Value(const std::string& t_str): Value(std::string_view(t_str)) {}
+    Value(const bool& t_val): str(t_val ? "true" : "false"), is_string(false) {}
+
+    template<typename T, typename =
+        std::enable_if_t<std::is_arithmetic_v<T>>>
+    Value(const T& t_val): str(format_number(t_val)), is_string(false) {}
+
+    std::string str;
+    bool is_string;
+  };
+
+  // Return false if format name is unknown.
+  static bool set_format(const std::string& name);
+  inline static Format get_format() { return m_format; }
+  // Whether analyses must write records instead of terminal rendering.
+  inline static bool is_machine() { return m_format != FMT_TABLE; }
+
+  // Start report with given columns. In CSV format header is written.
+  static void begin_report(
+      const std::string& name, const std::vector<std::string>& columns);
+  // Values follow columns of current report.
+  static void write_record(std::initializer_list<Value>);
+  static void write_record(const std::vector<Value>&);
+  static void end_report();
+
+private:
+  template<typename T>
+  static std::string format_number(const T& t_val) {
+    if constexpr (std::is_floating_point_v<T>) {
+      return format_double(t_val);
+    } else {
+      return std::to_string(t_val);
+    }
+  }
+  static std::string format_double(const double&);
+
+  static void write_record(const Value* begin, const Value* end);
+  static void append_json_string(const std::string&);
+  static void append_csv_field(const Value&);
+
+  // Records are buffered and flushed when buffer is large enough.
+  static const std::size_t FLUSH_SIZE;
+
+  static Format m_format;
+  static std::unique_ptr<std::ostream> m_out;
+  static std::string m_report;
+  static std::vector<std::string> m_columns;
+  static std::string m_buffer;
+  static bool m_is_first_report;
+};
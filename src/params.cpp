@@ -18,16 +18,27 @@
 #include "params.hpp"
 
 #include <algorithm>
+#include <ctime>
 #include <deque>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
+#include "batch.hpp"
 #include "comment.hpp"
+#include "daemon.hpp"
 #include "data.hpp"
+#include "history.hpp"
 #include "instanalyzer.hpp"
 #include "location.hpp"
 #include "modules.hpp"
+#include "output.hpp"
 #include "profile.hpp"
+#include "tags.hpp"
 #include "term.hpp"
+#include "timings.hpp"
+#include "trace.hpp"
+#include "worker.hpp"
 
 using namespace std;
 
@@ -41,11 +52,57 @@ const map<Params::Parameters, Params::ParamInfo> Params::m_params = {
   {PARAM_TOP_POSTS, {{"-p", "--top-posts"},
       "Show top of most (or less with prefix \"r\") liked posts.",
       true, false, "count"}},
+  {PARAM_SORT, {{"--sort", "-s"},
+      "Order of top posts: likes (default), comments or date.",
+      false, false, "order"}},
+  {PARAM_SINCE, {{"--since"},
+      "Show top of posts created (or diff of snapshots taken) since date "
+      "(YYYY-MM-DD).",
+      false, false, "date"}},
+  {PARAM_UNTIL, {{"--until"},
+      "Show top of posts created (or diff of snapshots taken) until date "
+      "(YYYY-MM-DD, inclusive).",
+      false, false, "date"}},
   {PARAM_TAGGED_PROFILES, {{"-t", "--tagged"},
       "Show often tagged profiles.", true}},
+  {PARAM_HEATMAP, {{"--heatmap"},
+      "Show heatmap of tags positions on pictures.", true}},
+  {PARAM_ENGAGEMENT, {{"-e", "--engagement"},
+      "Show likes and posting frequency over time.", true}},
+  {PARAM_HASHTAGS, {{"--hashtags"},
+      "Show most used hashtags in captions and comments.", true}},
+  {PARAM_MENTIONS, {{"--mentions"},
+      "Show most mentioned profiles in captions and comments.", true}},
   {PARAM_PROFILE_INFO, {{"-i", "--info"}, "Show profile info.", true}},
   {PARAM_UPDATE_PROFILE,
       {{"-u", "--update"}, "Force update local copy of profile.", true}},
+  {PARAM_DIFF, {{"--diff"},
+      "Show changes between snapshots, saved on updates (limited by "
+      "\"--since\" and \"--until\").", true}},
+  {PARAM_BATCH_UPDATE, {{"-b", "--batch"},
+      "Update profiles listed in file (\"-\" to read from stdin).",
+      true, false, "file"}},
+  {PARAM_JOBS, {{"--jobs", "-j"},
+      "Count of parallel updates in batch mode.", false, false, "count"}},
+  {PARAM_RATE, {{"--rate"},
+      "Maximum of started updates per minute in batch mode.",
+      false, false, "count"}},
+  {PARAM_WORKER, {{"--worker", "-w"},
+      "Run Instaloader as persistent worker process.", false}},
+  {PARAM_FORMAT, {{"--format", "-f"},
+      "Output format: table (default), ndjson or csv.", false, false,
+      "format"}},
+  {PARAM_TIMINGS, {{"--timings"},
+      "Print time spent in phases of processing at exit.", false}},
+  {PARAM_MEM_REPORT, {{"--mem-report"},
+      "Print allocations and peak memory of phases at exit.", false}},
+  {PARAM_TRACE, {{"--trace"},
+      "Write events of processing to file in Chrome trace format.", false,
+      false, "file"}},
+  {PARAM_DAEMON, {{"--daemon", "-d"},
+      "Serve requests of clients, keeping loaded profiles in memory.", false}},
+  {PARAM_CLIENT, {{"--client"},
+      "Send following parameters to running daemon (must be first).", false}},
   {PARAM_GEOCODER, {{"--geocoder", "-g"},
       "Change geocoder (if available).", false}},
   {PARAM_THEME, {{"--theme"}, "Change theme.", false}},
@@ -60,6 +117,12 @@ void Params::process_params(const vector<string>& t_params) {
     exit(EXIT_SUCCESS);
   }
 
+  const auto& client_names = m_params.at(PARAM_CLIENT).names;
+  if (find(client_names.cbegin(), client_names.cend(), t_params.front()) !=
+      client_names.cend()) {
+    exit(Daemon::forward({t_params.cbegin() + 1, t_params.cend()}));
+  }
+
   // Get value which associated with parameter.
   // Return empty string if value doesn't exist
   const auto& get_val = [&t_params]
@@ -75,6 +138,9 @@ void Params::process_params(const vector<string>& t_params) {
 
   bool request_profile = false;
   string profile;
+  unsigned int jobs = Batch::get_default_jobs(),
+      rate = Batch::get_default_rate();
+  Data::PostsQuery posts_query;
   set<Parameters> used_params;
   deque<function<void()>> funcs;
 
@@ -152,19 +218,162 @@ void Params::process_params(const vector<string>& t_params) {
             ++p;
           }
 
-          funcs.push_back([&profile, count] {
-            Data::show_posts_top(profile, count);
+          funcs.push_back([&profile, count, &posts_query] {
+            Data::show_posts_top(profile, count, posts_query);
           });
           continue;
         }
+        case PARAM_SORT: {
+          static const map<string, Data::PostsOrder> orders = {
+            {"likes", Data::ORDER_LIKES},
+            {"comments", Data::ORDER_COMMENTS},
+            {"date", Data::ORDER_RECENT}
+          };
+          const auto& order = orders.find(get_val(p));
+
+          if (order == orders.cend()) {
+            Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
+                "Parameter \"" + *p + "\" receive one of values: "
+                "#{bold}likes#{reset}, #{bold}comments#{reset}, "
+                "#{bold}date#{reset}!"));
+            exit(EXIT_FAILURE);
+          }
+
+          posts_query.order = order->second;
+          ++p;
+          continue;
+        }
+        case PARAM_SINCE:
+        case PARAM_UNTIL: {
+          istringstream ss(get_val(p));
+          tm date = {};
+          ss >> get_time(&date, "%Y-%m-%d");
+          date.tm_isdst = -1;
+
+          if (ss.fail()) {
+            Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
+                "Parameter \"" + *p + "\" receive the date in format "
+                "#{bold}YYYY-MM-DD#{reset}!"));
+            exit(EXIT_FAILURE);
+          }
+
+          if (i.first == PARAM_SINCE) {
+            posts_query.since = mktime(&date);
+          } else {
+            // Whole last day is included.
+            ++date.tm_mday;
+            posts_query.until = mktime(&date) - 1;
+          }
+          ++p;
+          continue;
+        }
         case PARAM_TAGGED_PROFILES:
           request_profile = true;
           funcs.push_back([&profile] { Data::show_tagged_profiles(profile); });
           continue;
+        case PARAM_HEATMAP:
+          request_profile = true;
+          funcs.push_back([&profile] { Data::show_tags_heatmap(profile); });
+          continue;
+        case PARAM_ENGAGEMENT:
+          request_profile = true;
+          funcs.push_back([&profile] { Data::show_engagement(profile); });
+          continue;
+        case PARAM_HASHTAGS:
+        case PARAM_MENTIONS: {
+          request_profile = true;
+          const Tags::Kind kind = i.first == PARAM_HASHTAGS ?
+              Tags::KIND_HASHTAG : Tags::KIND_MENTION;
+          funcs.push_back([&profile, kind] { Tags::show_tags(profile, kind); });
+          continue;
+        }
         case PARAM_UPDATE_PROFILE:
           request_profile = true;
           funcs.push_front([&profile] { Profile(profile).update(); });
           continue;
+        case PARAM_DIFF:
+          request_profile = true;
+          funcs.push_back([&profile, &posts_query] {
+            History::show_diff(profile, posts_query.since, posts_query.until);
+          });
+          continue;
+        case PARAM_BATCH_UPDATE: {
+          const string& val = get_val(p);
+
+          if (val.empty() && (p + 1 == t_params.cend() || *(p + 1) != "-")) {
+            Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
+                "Need specify file with profiles with parameter "
+                "\"#{red_out}" + *p + "#{reset}\"!"));
+            exit(EXIT_FAILURE);
+          }
+
+          funcs.push_back([val,&jobs,&rate] {
+            if (!Batch::update_profiles(val.empty() ? "-" : val, jobs, rate)) {
+              exit(EXIT_FAILURE);
+            }
+          });
+          ++p;
+          continue;
+        }
+        case PARAM_JOBS:
+        case PARAM_RATE: {
+          const string& val = get_val(p);
+          unsigned int count = 0;
+
+          try {
+            count = stoul(val);
+          } catch (const exception&) {}
+
+          if (count == 0) {
+            Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
+                "Parameter \"" + *p + "\" receive the positive integer value!"));
+            exit(EXIT_FAILURE);
+          }
+
+          (i.first == PARAM_JOBS ? jobs : rate) = count;
+          ++p;
+          continue;
+        }
+        case PARAM_WORKER:
+          Worker::set_enabled(true);
+          continue;
+        case PARAM_FORMAT:
+          if (!Output::set_format(get_val(p))) {
+            Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
+                "Parameter \"" + *p + "\" receive one of values: "
+                "#{bold}table#{reset}, #{bold}ndjson#{reset}, "
+                "#{bold}csv#{reset}!"));
+            exit(EXIT_FAILURE);
+          }
+          ++p;
+          continue;
+        case PARAM_TIMINGS:
+          Timings::set_enabled(true);
+          continue;
+        case PARAM_MEM_REPORT:
+          Timings::set_memory_enabled(true);
+          continue;
+        case PARAM_TRACE: {
+          const string& val = get_val(p);
+
+          if (val.empty()) {
+            Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
+                "Need specify file for trace with parameter \"#{red_out}" +
+                *p + "#{reset}\"!"));
+            exit(EXIT_FAILURE);
+          }
+
+          Trace::set_output(val);
+          ++p;
+          continue;
+        }
+        case PARAM_DAEMON:
+          funcs.push_back(Daemon::run);
+          continue;
+        case PARAM_CLIENT:
+          Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
+              "Parameter \"#{red_out}" + *p + "#{reset}\" must be first!"));
+          exit(EXIT_FAILURE);
         case PARAM_GEOCODER:
           Location::set_geocoder(Location::request_geocoder());
           Instanalyzer::set_pref("geocoder", to_string(Location::get_geocoder()));
@@ -208,6 +417,34 @@ void Params::process_params(const vector<string>& t_params) {
   }
 }
 
+string Params::find_profile(const vector<string>& t_params) {
+  string profile;
+
+  // Values of parameters are skipped by the same rules,
+  // as in process_params().
+  for (auto p = t_params.cbegin(); p != t_params.cend(); ++p) {
+    if (p->substr(0, 1) != "-") {
+      profile = *p;
+      continue;
+    }
+
+    for (const auto& i : m_params) {
+      if (i.second.val.empty() || find(i.second.names.cbegin(),
+          i.second.names.cend(), *p) == i.second.names.cend()) {
+        continue;
+      }
+
+      const auto& val = p + 1;
+      if (val != t_params.cend() && val->substr(0, 1) != "-" &&
+          (i.first != PARAM_TOP_POSTS || val + 1 != t_params.cend())) {
+        ++p;
+      }
+      break;
+    }
+  }
+  return profile;
+}
+
 void Params::show_help() {
   string main_params = "Main parameters:\n", other_params = "Other parameters:\n";
 
@@ -237,30 +474,29 @@ void Params::show_version() {
   cout << Term::process_colors(
       "Instanalyzer: #{cream_out}" + string(VERSION) + "#{reset}") << endl;
 
-  const auto& python_fver = [] (const string& str) {
-    cout << Term::process_colors("Python: #{cream_out}" +
-        str.substr(str.find(' ') + 1, str.size()) + "#{reset}") << endl;
-  };
-  const auto& python_ferr = [] ([[maybe_unused]] const string& str) {
+  // Both versions are got without running Python, interpreter is
+  // searched only if its cached path became outdated.
+  string python_version;
+  try {
+    python_version = Modules::get_interpreter_version();
+  } catch (const exception&) {}
+
+  if (python_version.empty()) {
     Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
         "Version of #{bold}Python#{reset} didn't get! "
         "Maybe, it didn't install?"));
     exit(EXIT_FAILURE);
-  };
-  Modules::interpreter("--version", python_fver, python_ferr);
+  }
+  cout << Term::process_colors("Python: #{cream_out}" +
+      python_version.substr(python_version.find(' ') + 1) + "#{reset}") << endl;
 
-  const auto& instaloader_fver = [] (const string& str) {
-    cout << Term::clear_line() + Term::process_colors(
-        "Instaloader: #{cream_out}" + str + "#{reset}") << endl;
-  };
-  const auto& instaloader_ferr = [] ([[maybe_unused]] const string& str) {
-    cout << Term::clear_line() << flush;
+  const string& instaloader_version = Modules::get_instaloader_version();
+  if (instaloader_version.empty()) {
     Instanalyzer::msg(Instanalyzer::MSG_ERR, Term::process_colors(
         "Version of #{bold}Instaloader#{reset} didn't get! "
         "Try to update modules."));
     exit(EXIT_FAILURE);
-  };
-
-  cout << Term::process_colors("\rInstaloader: #{gray_out}...#{reset}") << flush;
-  Modules::instaloader("--version", instaloader_fver, instaloader_ferr);
+  }
+  cout << Term::process_colors(
+      "Instaloader: #{cream_out}" + instaloader_version + "#{reset}") << endl;
 }
@@ -24,6 +24,9 @@
 class Params {
 public:
   static void process_params(const std::vector<std::string>&);
+  // Return name of profile, which parameters are related to,
+  // or empty string if it isn't specified.
+  static std::string find_profile(const std::vector<std::string>&);
   static void show_help();
   static void show_version();
 
@@ -34,8 +37,26 @@ private:
     PARAM_PROFILE_COMMENTATORS,
     PARAM_COMMENTATOR_INFO,
     PARAM_TOP_POSTS,
+    PARAM_SORT,
+    PARAM_SINCE,
+    PARAM_UNTIL,
     PARAM_TAGGED_PROFILES,
+    PARAM_HEATMAP,
+    PARAM_ENGAGEMENT,
+    PARAM_HASHTAGS,
+    PARAM_MENTIONS,
     PARAM_UPDATE_PROFILE,
+    PARAM_DIFF,
+    PARAM_BATCH_UPDATE,
+    PARAM_JOBS,
+    PARAM_RATE,
+    PARAM_WORKER,
+    PARAM_FORMAT,
+    PARAM_TIMINGS,
+    PARAM_MEM_REPORT,
+    PARAM_TRACE,
+    PARAM_DAEMON,
+    PARAM_CLIENT,
     PARAM_GEOCODER,
     PARAM_THEME,
     PARAM_UPDATE,
@@ -29,6 +29,7 @@ public:
 
   inline std::string get_shortcode() const { return m_shortcode; }
   inline unsigned int get_likes() const { return m_likes; }
+  inline unsigned int get_comments_count() const { return m_comments_count; }
   inline std::time_t get_creation_time() const { return m_creation_time; }
   inline std::set<Comment> get_comments() const { return m_comments; }
 
@@ -36,6 +37,9 @@ public:
     m_shortcode = t_shortcode;
   }
   inline void set_likes(const unsigned int& t_likes) { m_likes = t_likes; }
+  inline void set_comments_count(const unsigned int& t_count) {
+    m_comments_count = t_count;
+  }
   inline void set_creation_time(const std::time_t& t_time) {
     m_creation_time = t_time;
   }
@@ -46,6 +50,7 @@ public:
 private:
   std::string m_shortcode;
   unsigned int m_likes;
+  unsigned int m_comments_count = 0;
   std::time_t m_creation_time;
   std::set<Comment> m_comments;
 };
@@ -17,34 +17,42 @@
 
 #include "profile.hpp"
 
+#include <array>
+#include <cctype>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
 
+#include "history.hpp"
 #include "instanalyzer.hpp"
 #include "modules.hpp"
 #include "term.hpp"
+#include "timings.hpp"
+#include "trace.hpp"
+#include "worker.hpp"
 
 using namespace nlohmann;
 using namespace std;
 
 const unsigned int Profile::MAX_CACHED_POSTS = 10000;
+const unsigned int Profile::MAX_CONNECTION_ATTEMPTS = 10;
+
+const unsigned int Profile::PROGRESS_INTERVAL_MS = 100;
 
 const vector<Profile::MsgUpd> Profile::m_msgs_upd = {
-  {boost::regex("^\\s*\\[\\s*([^\\s\\/]+)\\s*\\/\\s*([^]\\s]+)\\s*].*$",
-      boost::regex::extended), Term::clear_line() +
+  {'[', match_progress,
       "Downloaded #{blue_out}$1#{reset} of #{blue_out}$2#{reset} posts..."}
 };
 
 const vector<Profile::ErrUpd> Profile::m_errs_upd = {
-  {boost::regex("^.+ ([^\\s]+) does not exist\\.$", boost::regex::extended),
-      "Profile #{red_out}@$1#{reset} doesn't exist!", true},
-  {boost::regex(".+ Max retries exceeded with url:.+\\[retrying; skip with \\^C]$",
-      boost::regex::extended), "Max connection retries exceeded.", false},
-  {boost::regex("^([^:]+): --login=USERNAME required.$", boost::regex::extended),
-      "Profile #{red_out}@$1#{reset} is private!", true}
+  {'.', match_not_exist, "Profile #{red_out}@$1#{reset} doesn't exist!", true},
+  {']', match_max_retries, "Max connection retries exceeded.", false},
+  {'.', match_private, "Profile #{red_out}@$1#{reset} is private!", true}
 };
 
-map<Profile, set<json>> Profile::m_cached_posts;
+map<string, Profile::CachedPosts> Profile::m_cached_posts;
+bool Profile::m_is_cache_unlimited = false;
 
 void Profile::init() {
   using namespace filesystem;
@@ -67,7 +75,9 @@ void Profile::check() const {
 
 void Profile::update() const {
   using namespace filesystem;
+  const Trace::Scope trace("Profile::update");
 
+  Instanalyzer::require(Instanalyzer::SUB_PROFILES | Instanalyzer::SUB_MODULES);
   cout << Term::process_colors(
       "Updating profile #{blue_out}@" + m_name + "#{reset}...") << endl;
 
@@ -75,26 +85,70 @@ void Profile::update() const {
     remove_all(get_profiles_path() / m_name);
   } catch (const exception&) {}
 
+  // Worker runs Instaloader itself, so it can't replay or record session.
+  if (Worker::is_enabled() && !Modules::is_replay() && !Modules::is_record()) {
+    update_by_worker();
+  } else {
+    update_by_instaloader();
+  }
+  cout << Term::clear_line() + "All posts updated." << endl;
+
+  remove_unused_files();
+  try {
+    History::save_snapshot(*this);
+  } catch (const exception& e) {
+    Instanalyzer::msg(Instanalyzer::MSG_WARN, e.what());
+  }
+  Instanalyzer::msg(Instanalyzer::MSG_INFO, "Update finished.");
+}
+
+void Profile::update_by_instaloader() const {
+  const Trace::Scope trace("Profile::update_by_instaloader");
   const auto& fout = [] (const string& str) {
-    for (const auto& m : m_msgs_upd) {
-      const string& fmt_str = boost::regex_replace(
-          str, m.msg_regex, Term::process_colors(m.replacement));
-      if (fmt_str != str) {
-        cout << fmt_str << flush;
+    using namespace chrono;
+
+    const size_t start = str.find_first_not_of(" \t");
+    if (start == string::npos) {
+      return;
+    }
+
+    static vector<string_view> groups;
+    static steady_clock::time_point last_print;
+
+    for (const auto& m : get_msg_rules(str[start])) {
+      groups.clear();
+      if (!m.first->matcher(str, groups)) {
+        continue;
+      }
+
+      // Skip too frequent updates, except the last one.
+      const auto& now = steady_clock::now();
+      if (now - last_print < milliseconds(PROGRESS_INTERVAL_MS) &&
+          (groups.size() < 2 || groups[0] != groups[1])) {
+        return;
       }
+      last_print = now;
+
+      cout << Term::clear_line() + m.second.render(groups) << flush;
+      return;
     }
   };
 
   static bool err_started = false;
   const auto& ferr = [] (const string& str) {
     if (!err_started) {
-      for (const auto& e : m_errs_upd) {
-        const string& fmt_str = boost::regex_replace(
-            str, e.err_regex, Term::process_colors(e.replacement));
-        if (!e.replacement.empty() && fmt_str != str) {
+      static vector<string_view> groups;
+      for (const auto& e : get_err_rules(str.empty() ? '\0' : str.back())) {
+        groups.clear();
+        if (!e.first->matcher(str, groups)) {
+          continue;
+        }
+
+        const string& fmt_str = e.second.render(groups);
+        if (!fmt_str.empty()) {
           cout << Term::clear_line() << flush;
 
-          if (e.is_critical) {
+          if (e.first->is_critical) {
             Instanalyzer::msg(Instanalyzer::MSG_ERR, fmt_str);
             exit(EXIT_FAILURE);
           } else {
@@ -114,112 +168,434 @@ void Profile::update() const {
     }
   };
 
-  static const unsigned int MAX_CONNECTION_ATTEMPTS = 10;
-  Modules::instaloader(
-      "-V -C -G --no-pictures --no-profile-pic --no-captions --no-compress-json "
-      "--max-connection-attempts=" + to_string(MAX_CONNECTION_ATTEMPTS) +
-      " --filename-pattern={shortcode} --dirname-pattern=" +
-      string(get_profiles_path()) + "/{target} " + m_name, fout, ferr);
+  Modules::instaloader(get_update_params(), fout, ferr);
 
   if (err_started) {
     cout << Term::clear_line() +
         Term::process_colors(" #{red_out}--- --- --- ---#{reset}") << endl;
     exit(EXIT_FAILURE);
-  } else {
-    cout << Term::clear_line() + "All posts updated." << endl;
   }
+}
 
-  remove_unused_files();
-  Instanalyzer::msg(Instanalyzer::MSG_INFO, "Update finished.");
+void Profile::update_async(const update_cb& t_cb) const {
+  using namespace filesystem;
+
+  Instanalyzer::require(Instanalyzer::SUB_PROFILES | Instanalyzer::SUB_MODULES);
+  error_code e;
+  remove_all(get_profiles_path() / m_name, e);
+
+  struct State {
+    string error;
+    // Critical error is final description of failure.
+    bool is_failed = false, is_critical = false, is_retries_exceeded = false;
+    vector<string_view> groups;
+  };
+  const auto& state = make_shared<State>();
+
+  const auto& ferr = [state] (const string& str) {
+    if (state->is_critical) {
+      return;
+    }
+
+    for (const auto& r : get_err_rules(str.empty() ? '\0' : str.back())) {
+      state->groups.clear();
+      if (!r.first->matcher(str, state->groups)) {
+        continue;
+      }
+
+      if (r.first->is_critical) {
+        state->error = r.second.render(state->groups);
+        state->is_failed = state->is_critical = true;
+      } else if (r.first->matcher == match_max_retries) {
+        state->is_retries_exceeded = true;
+      }
+      return;
+    }
+
+    state->error += (state->is_failed ? "\n" : "") + str;
+    state->is_failed = true;
+  };
+
+  const Profile profile = *this;
+  const auto& ffinish = [profile,state,t_cb] {
+    if (state->is_failed) {
+      t_cb(state->is_retries_exceeded && !state->is_critical ?
+          UPD_RETRY : UPD_FAILURE, state->error);
+      return;
+    }
+
+    try {
+      profile.clean_files();
+    } catch (const exception& e) {
+      t_cb(UPD_FAILURE, e.what());
+      return;
+    }
+
+    // Profile is updated anyway, so missed snapshot isn't failure.
+    try {
+      History::save_snapshot(profile);
+    } catch (const exception&) {}
+    t_cb(UPD_SUCCESS, "");
+  };
+
+  if (Worker::is_enabled() && !Modules::is_replay() && !Modules::is_record()) {
+    const auto& fevent = [state] (const json& t_event) {
+      if (t_event.value("event", "") != "error" || state->is_critical) {
+        return;
+      } else if (t_event.value("kind", "") == "connection") {
+        // Command may be repeated later.
+        state->is_retries_exceeded = true;
+      } else if (t_event.value("critical", false)) {
+        state->error = get_worker_error(t_event);
+        state->is_failed = state->is_critical = true;
+      }
+    };
+    const auto& fdone = [state,ffinish] (const json& t_event) {
+      if (!t_event.value("ok", false) && !state->is_failed) {
+        state->error = t_event.value("message", "");
+        state->is_failed = true;
+      }
+      ffinish();
+    };
+
+    Worker::request_async(get_worker_command(), fevent, fdone);
+    return;
+  }
+
+  Modules::instaloader_async(get_update_params(), nullptr, ferr,
+      [ffinish] (const int) { ffinish(); });
+}
+
+string Profile::get_update_params() const {
+  return "-V -C -G --no-pictures --no-profile-pic --no-captions "
+      "--no-compress-json --max-connection-attempts=" +
+      to_string(MAX_CONNECTION_ATTEMPTS) +
+      " --filename-pattern={shortcode} --dirname-pattern=" +
+      string(get_profiles_path()) + "/{target} " + m_name;
+}
+
+const vector<pair<const Profile::MsgUpd*, Profile::Template>>&
+    Profile::get_msg_rules(const char& t_prefix) {
+  // Templates are compiled on first use, because colors must be initialized.
+  static const auto& table = [] {
+    array<vector<pair<const MsgUpd*, Template>>, 256> rules;
+    for (const auto& m : m_msgs_upd) {
+      rules[static_cast<unsigned char>(m.prefix)].emplace_back(
+          &m, Template(m.replacement));
+    }
+    return rules;
+  }();
+  return table[static_cast<unsigned char>(t_prefix)];
+}
+
+const vector<pair<const Profile::ErrUpd*, Profile::Template>>&
+    Profile::get_err_rules(const char& t_suffix) {
+  static const auto& table = [] {
+    array<vector<pair<const ErrUpd*, Template>>, 256> rules;
+    for (const auto& e : m_errs_upd) {
+      rules[static_cast<unsigned char>(e.suffix)].emplace_back(
+          &e, Template(e.replacement));
+    }
+    return rules;
+  }();
+  return table[static_cast<unsigned char>(t_suffix)];
+}
+
+bool Profile::match_progress(
+    string_view t_line, vector<string_view>& t_groups) {
+  const auto& skip_spaces = [&t_line] (size_t& i) {
+    while (i < t_line.size() &&
+        isspace(static_cast<unsigned char>(t_line[i]))) {
+      ++i;
+    }
+  };
+  // Read value until space or one of characters.
+  const auto& read_value = [&t_line,&t_groups] (size_t& i, const char& t_end) {
+    const size_t start = i;
+    while (i < t_line.size() && t_line[i] != t_end &&
+        !isspace(static_cast<unsigned char>(t_line[i]))) {
+      ++i;
+    }
+    t_groups.push_back(t_line.substr(start, i - start));
+    return i != start;
+  };
+
+  // Format: "[ current/total] ...".
+  size_t i = 0;
+  skip_spaces(i);
+  if (i == t_line.size() || t_line[i] != '[') {
+    return false;
+  }
+
+  skip_spaces(++i);
+  if (!read_value(i, '/')) {
+    return false;
+  }
+  skip_spaces(i);
+  if (i == t_line.size() || t_line[i] != '/') {
+    return false;
+  }
+
+  skip_spaces(++i);
+  if (!read_value(i, ']')) {
+    return false;
+  }
+  skip_spaces(i);
+  return i != t_line.size() && t_line[i] == ']';
+}
+
+bool Profile::match_not_exist(
+    string_view t_line, vector<string_view>& t_groups) {
+  // Format: "... <profile> does not exist.".
+  const string_view& suffix = " does not exist.";
+  if (t_line.size() <= suffix.size() ||
+      t_line.substr(t_line.size() - suffix.size()) != suffix) {
+    return false;
+  }
+
+  const string_view& rest = t_line.substr(0, t_line.size() - suffix.size());
+  const size_t space = rest.find_last_of(" \t");
+
+  if (space == string_view::npos || space == 0 || space + 1 == rest.size()) {
+    return false;
+  }
+  t_groups.push_back(rest.substr(space + 1));
+  return true;
+}
+
+bool Profile::match_max_retries(
+    string_view t_line, [[maybe_unused]] vector<string_view>& t_groups) {
+  // Format: "... Max retries exceeded with url: ... [retrying; skip with ^C]".
+  const string_view& suffix = "[retrying; skip with ^C]";
+  if (t_line.size() <= suffix.size() ||
+      t_line.substr(t_line.size() - suffix.size()) != suffix) {
+    return false;
+  }
+
+  const size_t pos = t_line.find(" Max retries exceeded with url:");
+  return pos != string_view::npos && pos != 0 &&
+      pos < t_line.size() - suffix.size();
+}
+
+bool Profile::match_private(
+    string_view t_line, vector<string_view>& t_groups) {
+  // Format: "<profile>: --login=USERNAME required.".
+  const string_view& suffix = ": --login=USERNAME required.";
+  if (t_line.size() <= suffix.size() ||
+      t_line.substr(t_line.size() - suffix.size()) != suffix) {
+    return false;
+  }
+
+  const string_view& name = t_line.substr(0, t_line.size() - suffix.size());
+  if (name.find(':') != string_view::npos) {
+    return false;
+  }
+  t_groups.push_back(name);
+  return true;
+}
+
+Profile::Template::Template(const string& t_replacement) {
+  const string& str = Term::process_colors(t_replacement);
+  string literal;
+
+  for (size_t i = 0; i < str.size(); ++i) {
+    if (str[i] == '$' && i + 1 < str.size() &&
+        isdigit(static_cast<unsigned char>(str[i + 1]))) {
+      m_segments.emplace_back(literal, str[++i] - '1');
+      literal.clear();
+    } else {
+      literal += str[i];
+    }
+  }
+  m_segments.emplace_back(literal, -1);
+}
+
+string Profile::Template::render(const vector<string_view>& t_groups) const {
+  string str;
+
+  for (const auto& s : m_segments) {
+    str += s.first;
+    if (s.second >= 0 && static_cast<size_t>(s.second) < t_groups.size()) {
+      str += t_groups[s.second];
+    }
+  }
+  return str;
+}
+
+void Profile::update_by_worker() const {
+  const Trace::Scope trace("Profile::update_by_worker");
+  const auto& fevent = [] (const json& event) {
+    const string& type = event.value("event", "");
+
+    if (type == "progress") {
+      cout << Term::clear_line() + Term::process_colors(
+          "Downloaded #{blue_out}" + to_string(event.value("current", 0)) +
+          "#{reset} of #{blue_out}" + to_string(event.value("total", 0)) +
+          "#{reset} posts...") << flush;
+      return;
+    } else if (type != "error") {
+      return;
+    }
+
+    const string& kind = event.value("kind", "");
+    cout << Term::clear_line() << flush;
+
+    if (!event.value("critical", false)) {
+      Instanalyzer::msg(Instanalyzer::MSG_WARN, kind == "connection" ?
+          "Max connection retries exceeded." : event.value("message", ""));
+      return;
+    }
+
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, get_worker_error(event));
+    exit(EXIT_FAILURE);
+  };
+
+  json response;
+  try {
+    response = Worker::request(get_worker_command(), fevent);
+  } catch (const exception& e) {
+    cout << Term::clear_line() << flush;
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, e.what());
+    exit(EXIT_FAILURE);
+  }
+
+  if (!response.value("ok", false)) {
+    cout << Term::clear_line() << flush;
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, "Update of profile failed!");
+    exit(EXIT_FAILURE);
+  }
+}
+
+json Profile::get_worker_command() const {
+  return {
+    {"cmd", "download"},
+    {"profile", m_name},
+    {"max_connection_attempts", MAX_CONNECTION_ATTEMPTS},
+    {"filename_pattern", "{shortcode}"},
+    {"dirname_pattern", string(get_profiles_path()) + "/{target}"}
+  };
+}
+
+string Profile::get_worker_error(const json& t_event) {
+  const string& kind = t_event.value("kind", "");
+  const string& name = t_event.value("profile", "");
+
+  if (kind == "not_exists") {
+    return Term::process_colors(
+        "Profile #{red_out}@" + name + "#{reset} doesn't exist!");
+  } else if (kind == "private") {
+    return Term::process_colors(
+        "Profile #{red_out}@" + name + "#{reset} is private!");
+  }
+  return Term::process_colors("Error occurred while updating profile:\n"
+      " #{red_out}--- --- --- ---#{gray_out}\n") +
+      t_event.value("message", "") + Term::process_colors(
+      "\n #{red_out}--- --- --- ---#{reset}");
 }
 
 void Profile::remove_unused_files() const {
-  using namespace filesystem;
+  const Trace::Scope trace("Profile::remove_unused_files");
   cout << "\rRemoving unused files..." << flush;
 
+  try {
+    clean_files();
+  } catch (const exception& e) {
+    cout << Term::clear_line() << flush;
+    Instanalyzer::msg(Instanalyzer::MSG_ERR, e.what());
+    exit(EXIT_FAILURE);
+  }
+  cout << Term::clear_line() + "Unused files removed." << endl;
+}
+
+void Profile::clean_files() const {
+  using namespace filesystem;
+
   const path& profile_path = get_profiles_path() / m_name;
   const set<string> unused_postfixes = {"_comments.json", "_location.txt"};
 
   for (const auto& f : directory_iterator(profile_path)) {
     const string& path(f.path());
     for (const auto& p : unused_postfixes) {
-      if (path.substr(path.size() - p.size()) == p) {
-        try {
-          remove(f);
-        } catch (const exception& e) {
-          cout << Term::clear_line() << flush;
-          Instanalyzer::msg(Instanalyzer::MSG_ERR, e.what());
-          exit(EXIT_FAILURE);
-        }
+      if (path.size() >= p.size() &&
+          path.substr(path.size() - p.size()) == p) {
+        remove(f);
       }
     }
   }
 
   ifstream ifs(profile_path / "id");
   if (ifs.fail()) {
-    cout << Term::clear_line() << flush;
-    Instanalyzer::msg(Instanalyzer::MSG_ERR,
-        "File with ID of profile didn't open!");
-    exit(EXIT_FAILURE);
+    throw runtime_error("File with ID of profile didn't open!");
   }
 
   string id; ifs >> id;
   ifs.close();
 
-  try {
-    rename(string(profile_path / m_name) + '_' + id + ".json",
-        profile_path / "profile.json");
-  } catch (const exception& e) {
-    cout << Term::clear_line() << flush;
-    Instanalyzer::msg(Instanalyzer::MSG_ERR, e.what());
-    exit(EXIT_FAILURE);
-  }
+  rename(string(profile_path / m_name) + '_' + id + ".json",
+      profile_path / "profile.json");
   remove(profile_path / "id");
-
-  cout << Term::clear_line() + "Unused files removed." << endl;
 }
 
 set<json> Profile::get_posts(const bool& t_use_cache) const {
   using namespace filesystem;
-
-  if (t_use_cache) {
-    const auto& cached_posts = m_cached_posts[*this];
-    if (!cached_posts.empty()) {
-      return cached_posts;
-    }
-  }
+  const Timings::Scope timing(Timings::PHASE_POSTS);
 
   const path& profile_path = get_profiles_path() / m_name;
-  if (!directory_entry(profile_path).exists()) {
+  // Outdated cache isn't used.
+  const file_time_type& stamp = get_posts_stamp();
+  if (stamp == file_time_type::min()) {
     return {};
   }
 
-  const set<string> exclude_files = {
-    "profile.json"
-  };
+  if (t_use_cache) {
+    const auto& cached = m_cached_posts.find(m_name);
+    if (cached != m_cached_posts.cend() && cached->second.stamp == stamp) {
+      return cached->second.posts;
+    }
+  }
+
   set<json> posts;
+  for (const auto& f : directory_iterator(profile_path)) {
+    read_post_file(f, posts);
+  }
 
-  for (const auto f : directory_iterator(profile_path)) {
-    if (f.is_directory() || exclude_files.count(f.path().filename()) != 0) {
-      continue;
-    }
+  if (t_use_cache &&
+      (m_is_cache_unlimited || posts.size() <= MAX_CACHED_POSTS)) {
+    m_cached_posts[m_name] = {stamp, posts};
+  }
+  return posts;
+}
 
-    ifstream ifs(f.path());
-    if (ifs.fail()) {
-      continue;
-    }
-    stringstream ss;
-    ss << ifs.rdbuf();
+void Profile::read_post_file(const filesystem::directory_entry& t_file,
+    set<json>& t_posts) {
+  if (t_file.is_directory() || t_file.path().filename() == "profile.json") {
+    return;
+  }
 
-    try {
-      posts.insert(json::parse(ss.str()));
-    } catch (const exception&) {
-      continue;
-    }
+  ifstream ifs(t_file.path());
+  if (ifs.fail()) {
+    return;
   }
+  stringstream ss;
+  ss << ifs.rdbuf();
 
-  if (t_use_cache && posts.size() <= MAX_CACHED_POSTS) {
-    m_cached_posts[*this] = posts;
+  try {
+    t_posts.insert(json::parse(ss.str()));
+  } catch (const exception&) {
+    return;
   }
-  return posts;
+}
+
+void Profile::set_cached_posts(const filesystem::file_time_type& t_stamp,
+    set<json>&& t_posts) const {
+  m_cached_posts[m_name] = {t_stamp, move(t_posts)};
+}
+
+filesystem::file_time_type Profile::get_posts_stamp() const {
+  using namespace filesystem;
+
+  error_code e;
+  const file_time_type& stamp =
+      last_write_time(get_profiles_path() / m_name, e);
+  return e ? file_time_type::min() : stamp;
 }
@@ -18,30 +18,24 @@
 #pragma once
 
 #include <filesystem>
-#include <memory>
+#include <functional>
 #include <set>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
-#include "boost/regex.hpp"
 #include "nlohmann/json.hpp"
 
 #include "instanalyzer.hpp"
 
 class Profile {
 public:
-  struct TaggedProfile {
-    TaggedProfile() = default;
-    TaggedProfile(const Profile& t_profile):
-        profile(std::make_shared<Profile>(t_profile)) {}
-
-    inline bool operator <(const TaggedProfile& rhs) const {
-      return *profile < *rhs.profile || post_shortcode < rhs.post_shortcode;
-    }
-
-    std::shared_ptr<Profile> profile;
-    std::string post_shortcode;
-    double x, y;
+  enum UpdateStatus {
+    UPD_SUCCESS,
+    // Failed due to exceeded connection retries, may be repeated later.
+    UPD_RETRY,
+    UPD_FAILURE
   };
 
   Profile() = default;
@@ -61,8 +55,32 @@ public:
 
   void check() const;
   void update() const;
+  // Callback with result of update and description of failure.
+  typedef std::function<void(const UpdateStatus&, const std::string& error)>
+      update_cb;
+
+  // Start update without any output and exit on error (used for batch
+  // updates). Callback is called by Reactor when update finished.
+  // With enabled worker, command is sent to pool of workers.
+  void update_async(const update_cb&) const noexcept(false);
   void remove_unused_files() const;
   std::set<nlohmann::json> get_posts(const bool& use_cache = true) const;
+  // Add post from file of local copy to "posts", other files are
+  // skipped. Used to load posts by parts.
+  static void read_post_file(const std::filesystem::directory_entry& file,
+      std::set<nlohmann::json>& posts);
+  // Store posts, which are loaded without cache (e.g. by parts), as
+  // loaded at "stamp".
+  void set_cached_posts(const std::filesystem::file_time_type& stamp,
+      std::set<nlohmann::json>&& posts) const;
+  // Modification time of local copy, changed by every update.
+  // Return minimal time if local copy doesn't exist.
+  std::filesystem::file_time_type get_posts_stamp() const;
+  // By default posts of large profiles aren't cached, but long-living
+  // processes (daemon) keep them anyway.
+  inline static void set_cache_unlimited(const bool& t_is_unlimited) {
+    m_is_cache_unlimited = t_is_unlimited;
+  }
 
   static void init() noexcept(false);
   inline static std::filesystem::path get_profiles_path() {
@@ -70,23 +88,76 @@ public:
   }
 
 private:
+  // Return true if line matched. Captured values of "groups"
+  // substituted instead of $1, $2, ... in replacement.
+  typedef bool (*line_matcher)(
+      std::string_view line, std::vector<std::string_view>& groups);
+
   struct MsgUpd {
-    boost::regex msg_regex;
+    // First non-space character of matching lines.
+    char prefix;
+    line_matcher matcher;
     std::string replacement;
   };
 
   struct ErrUpd {
-    boost::regex err_regex;
+    // Last character of matching lines.
+    char suffix;
+    line_matcher matcher;
     std::string replacement;
     bool is_critical;
   };
 
+  // Replacement with processed colors, split into literals and groups.
+  class Template {
+  public:
+    Template(const std::string& replacement);
+    std::string render(const std::vector<std::string_view>& groups) const;
+
+  private:
+    // Literal and index of group which follows it (-1 if none).
+    std::vector<std::pair<std::string, int>> m_segments;
+  };
+
+  std::string get_update_params() const;
+  void update_by_instaloader() const;
+  static bool match_progress(std::string_view, std::vector<std::string_view>&);
+  static bool match_not_exist(std::string_view, std::vector<std::string_view>&);
+  static bool match_max_retries(
+      std::string_view, std::vector<std::string_view>&);
+  static bool match_private(std::string_view, std::vector<std::string_view>&);
+
+  // Download posts using persistent Instaloader worker.
+  void update_by_worker() const;
+  nlohmann::json get_worker_command() const;
+  // Description of critical error event of worker.
+  static std::string get_worker_error(const nlohmann::json& event);
+  // Throw exception on error.
+  void clean_files() const noexcept(false);
+
+  // Return rules for lines with given first (or last for errors) character.
+  static const std::vector<std::pair<const MsgUpd*, Template>>&
+      get_msg_rules(const char& prefix);
+  static const std::vector<std::pair<const ErrUpd*, Template>>&
+      get_err_rules(const char& suffix);
+
   std::string m_id, m_name, m_full_name;
   bool m_is_verified;
 
   static const unsigned int MAX_CACHED_POSTS;
+  static const unsigned int MAX_CONNECTION_ATTEMPTS;
+  // Minimal interval between printing of download progress.
+  static const unsigned int PROGRESS_INTERVAL_MS;
 
   static const std::vector<MsgUpd> m_msgs_upd;
   static const std::vector<ErrUpd> m_errs_upd;
-  static std::map<Profile, std::set<nlohmann::json>> m_cached_posts;
+  // Posts with modification time of directory they were loaded from.
+  struct CachedPosts {
+    std::filesystem::file_time_type stamp;
+    std::set<nlohmann::json> posts;
+  };
+
+  // Keys are names, because profiles may be created without identifier.
+  static std::map<std::string, CachedPosts> m_cached_posts;
+  static bool m_is_cache_unlimited;
 };
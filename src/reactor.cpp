@@ -0,0 +1,218 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "reactor.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "boost/process.hpp"
+
+using namespace std;
+
+struct Reactor::Process {
+  boost::process::pipe pipes[2];
+  boost::process::pipe input;
+  bool has_input = false;
+  boost::process::child child;
+
+  // Incomplete lines of streams (not longer than BUFFER_SIZE).
+  string lines[2];
+  bool is_open[2] = {true, true};
+
+  Modules::parser_cb callbacks[2];
+  exit_cb cb_exit;
+};
+
+const size_t Reactor::BUFFER_SIZE = 64 * 1024;
+
+map<unsigned long, unique_ptr<Reactor::Process>> Reactor::m_processes;
+unsigned long Reactor::m_last_id = 0;
+int Reactor::m_epoll_fd = -1;
+
+unsigned long Reactor::spawn(const string& t_command,
+    const Modules::parser_cb& t_cb_out, const Modules::parser_cb& t_cb_err,
+    const exit_cb& t_cb_exit, const bool& t_with_input) {
+  using namespace boost::process;
+
+  if (m_epoll_fd == -1) {
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd == -1) {
+      throw runtime_error("Can't create epoll instance: " +
+          string(strerror(errno)) + '.');
+    }
+  }
+
+  auto process = make_unique<Process>();
+  process->callbacks[0] = t_cb_out;
+  process->callbacks[1] = t_cb_err;
+  process->cb_exit = t_cb_exit;
+
+  if (t_with_input) {
+    process->child = child(t_command, std_in < process->input,
+        std_out > process->pipes[0], std_err > process->pipes[1]);
+    // Other children mustn't inherit this end of pipe.
+    fcntl(process->input.native_sink(), F_SETFD, FD_CLOEXEC);
+    process->has_input = true;
+  } else {
+    process->child = child(t_command,
+        std_out > process->pipes[0], std_err > process->pipes[1]);
+  }
+
+  const unsigned long id = ++m_last_id;
+  for (int s = 0; s < 2; ++s) {
+    const int fd = process->pipes[s].native_source();
+    // Other children mustn't inherit this end of pipe.
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = id * 2 + s;
+
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+      throw runtime_error("Can't watch output of process: " +
+          string(strerror(errno)) + '.');
+    }
+  }
+  m_processes.emplace(id, move(process));
+  return id;
+}
+
+void Reactor::write(const unsigned long& t_id, const string& t_data) {
+  const auto& process = m_processes.find(t_id);
+  if (process == m_processes.end() || !process->second->has_input) {
+    throw runtime_error("Process doesn't accept input.");
+  }
+
+  if (process->second->input.write(t_data.data(), t_data.size()) !=
+      static_cast<int>(t_data.size())) {
+    throw runtime_error("Can't write input of process: " +
+        string(strerror(errno)) + '.');
+  }
+}
+
+void Reactor::close_input(const unsigned long& t_id) {
+  const auto& process = m_processes.find(t_id);
+  if (process != m_processes.end() && process->second->has_input) {
+    process->second->input.close();
+    process->second->has_input = false;
+  }
+}
+
+void Reactor::run_once(const int& t_timeout_ms) {
+  if (m_epoll_fd == -1 || (m_processes.empty() && t_timeout_ms < 0)) {
+    return;
+  }
+
+  static const int MAX_EVENTS = 32;
+  array<epoll_event, MAX_EVENTS> events;
+
+  const int count =
+      epoll_wait(m_epoll_fd, events.data(), events.size(), t_timeout_ms);
+  if (count == -1) {
+    if (errno == EINTR) {
+      return;
+    }
+    throw runtime_error("Waiting for output of processes failed: " +
+        string(strerror(errno)) + '.');
+  }
+
+  for (int i = 0; i < count; ++i) {
+    const unsigned long id = events[i].data.u64 / 2;
+    const int stream = events[i].data.u64 % 2;
+
+    const auto& process_it = m_processes.find(id);
+    if (process_it == m_processes.end()) {
+      continue;
+    }
+
+    auto& process = *process_it->second;
+    read_stream(process, stream);
+
+    if (process.is_open[0] || process.is_open[1]) {
+      continue;
+    }
+
+    // Both streams are closed, so process finished.
+    process.child.wait();
+    const int exit_code = process.child.exit_code();
+    const exit_cb cb_exit = process.cb_exit;
+
+    m_processes.erase(process_it);
+    if (cb_exit != nullptr) {
+      cb_exit(exit_code);
+    }
+  }
+}
+
+void Reactor::run() {
+  while (!m_processes.empty()) {
+    run_once();
+  }
+}
+
+void Reactor::read_stream(Process& t_process, const int& t_stream) {
+  // All processes share one buffer, so memory usage doesn't depend on count.
+  static vector<char> buffer(BUFFER_SIZE);
+
+  const int fd = t_process.pipes[t_stream].native_source();
+  const auto& cb = t_process.callbacks[t_stream];
+  string& line = t_process.lines[t_stream];
+
+  const ssize_t count = read(fd, buffer.data(), buffer.size());
+  if (count < 0 && (errno == EINTR || errno == EAGAIN)) {
+    return;
+  }
+
+  if (count <= 0) {
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    t_process.is_open[t_stream] = false;
+
+    if (!line.empty() && cb != nullptr) {
+      cb(line);
+    }
+    line.clear();
+    return;
+  } else if (cb == nullptr) {
+    // Output must be read anyway, otherwise child may block on full pipe.
+    return;
+  }
+
+  const char* begin = buffer.data();
+  const char* end = begin + count;
+
+  for (const char* nl; (nl = find(begin, end, '\n')) != end; begin = nl + 1) {
+    line.append(begin, nl);
+    cb(line);
+    line.clear();
+  }
+  line.append(begin, end);
+
+  // Output without newlines is passed by parts, so pending line doesn't
+  // grow without limit.
+  if (line.size() >= BUFFER_SIZE) {
+    cb(line);
+    line.clear();
+  }
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "modules.hpp"
+
+// Single-threaded supervisor of child processes. Output pipes of all
+// children are polled by one epoll instance and passed line by line.
+class Reactor {
+public:
+  typedef std::function<void(const int exit_code)> exit_cb;
+
+  // Start process and return its identifier. Callbacks are called only
+  // from "run_once". Standard input is piped only if "with_input" is set.
+  static unsigned long spawn(const std::string& command,
+      const Modules::parser_cb& cb_out = nullptr,
+      const Modules::parser_cb& cb_err = nullptr,
+      const exit_cb& cb_exit = nullptr,
+      const bool& with_input = false) noexcept(false);
+  // Write data to standard input of process, which is spawned with it.
+  static void write(const unsigned long& id, const std::string& data)
+      noexcept(false);
+  // Close standard input, so process receives end of file.
+  static void close_input(const unsigned long& id);
+
+  // Wait for output no longer than "timeout_ms" (-1 - without limit)
+  // and dispatch it. Return immediately if no processes and no timeout.
+  static void run_once(const int& timeout_ms = -1) noexcept(false);
+  // Dispatch events until all processes finished.
+  static void run() noexcept(false);
+
+  inline static std::size_t get_processes_count() {
+    return m_processes.size();
+  }
+
+private:
+  struct Process;
+
+  // Read available data of stream (0 - stdout, 1 - stderr).
+  static void read_stream(Process&, const int& stream);
+
+  static const std::size_t BUFFER_SIZE;
+
+  static std::map<unsigned long, std::unique_ptr<Process>> m_processes;
+  static unsigned long m_last_id;
+  static int m_epoll_fd;
+};
@@ -0,0 +1,290 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tags.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "graph.hpp"
+#include "instanalyzer.hpp"
+#include "output.hpp"
+#include "term.hpp"
+
+using namespace nlohmann;
+using namespace std;
+
+const array<uint8_t, 256> Tags::m_classes = [] {
+  array<uint8_t, 256> classes = {};
+
+  for (unsigned int c = 0; c < classes.size(); ++c) {
+    if (c >= '0' && c <= '9') {
+      classes[c] = CLASS_WORD | CLASS_DIGIT;
+    } else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') {
+      classes[c] = CLASS_WORD;
+    } else if (c == '.') {
+      classes[c] = CLASS_DOT;
+    } else if (c >= 0x80 && c <= 0xbf) {
+      classes[c] = CLASS_CONT;
+    } else if (c >= 0xc3 && c <= 0xdf) {
+      // U+00C0 - U+07FF: Latin, Greek, Cyrillic, Hebrew, Arabic, etc.
+      classes[c] = CLASS_LEAD2;
+    } else if (c >= 0xe0 && c <= 0xef && c != 0xe2) {
+      // Except U+2000 - U+2FFF with punctuation, symbols and dingbats.
+      classes[c] = CLASS_LEAD3;
+    }
+  }
+  return classes;
+}();
+
+const unsigned int Tags::MAX_MENTION_LENGTH = 30;
+const unsigned int Tags::SHOWN_TAGS = 20;
+
+void Tags::show_tags(const Profile& t_profile, const Kind& t_kind) {
+  t_profile.check();
+
+  cout << "\rProcessing posts..." << flush;
+  const set<json>& posts = t_profile.get_posts();
+  cout << Term::clear_line() + "Extracting tags..." << flush;
+
+  struct TagStats {
+    const string* name;
+    unsigned int posts = 0, caption_uses = 0, comment_uses = 0;
+    // Index of last post, where tag was found.
+    size_t last_post = SIZE_MAX;
+  };
+
+  // Tags are interned, names are stored only in keys of map.
+  unordered_map<string, uint32_t> ids;
+  vector<TagStats> stats;
+  unsigned long long total_uses = 0;
+  size_t post_idx = 0;
+  string key;
+
+  const auto& add = [&] (const string_view& t_token, const bool& t_is_caption) {
+    key.assign(t_token.data(), t_token.size());
+    for (auto& c : key) {
+      if (c >= 'A' && c <= 'Z') {
+        c += 'a' - 'A';
+      }
+    }
+
+    auto id = ids.find(key);
+    if (id == ids.end()) {
+      id = ids.emplace(key, stats.size()).first;
+      stats.emplace_back();
+      stats.back().name = &id->first;
+    }
+
+    TagStats& s = stats[id->second];
+    ++(t_is_caption ? s.caption_uses : s.comment_uses);
+    if (s.last_post != post_idx) {
+      s.last_post = post_idx;
+      ++s.posts;
+    }
+    ++total_uses;
+  };
+
+  // Texts are read from JSON directly, without creating comments.
+  const auto& scan_texts = [&] (const json& t_node, const char* t_edge,
+      const bool& t_is_caption) {
+    const auto& edge = t_node.find(t_edge);
+    if (edge == t_node.end() || edge->find("edges") == edge->end()) {
+      return;
+    }
+
+    for (const auto& e : edge->at("edges")) {
+      const auto& node = e.find("node");
+      if (node == e.end()) {
+        continue;
+      }
+
+      const auto& text = node->find("text");
+      if (text != node->end() && text->is_string()) {
+        extract(text->get_ref<const string&>(),
+            [&] (const Kind& t_token_kind, const string_view& t_token) {
+          if (t_token_kind == t_kind) {
+            add(t_token, t_is_caption);
+          }
+        });
+      }
+    }
+  };
+
+  for (const auto& p : posts) {
+    const auto& node = p.find("node");
+    if (node != p.end()) {
+      scan_texts(*node, "edge_media_to_caption", true);
+      scan_texts(*node, "edge_media_to_comment", false);
+    }
+    ++post_idx;
+  }
+
+  const string& name = t_kind == KIND_HASHTAG ? "hashtags" : "mentions";
+  const char marker = t_kind == KIND_HASHTAG ? '#' : '@';
+  cout << Term::clear_line() << flush;
+
+  if (stats.empty()) {
+    Instanalyzer::msg(Instanalyzer::MSG_WARN, "No " + name + "!");
+    return;
+  }
+
+  const auto& cmp = [] (const TagStats& lhs, const TagStats& rhs) {
+    const unsigned int lhs_uses = lhs.caption_uses + lhs.comment_uses,
+        rhs_uses = rhs.caption_uses + rhs.comment_uses;
+    if (lhs_uses != rhs_uses) {
+      return lhs_uses > rhs_uses;
+    } else if (lhs.posts != rhs.posts) {
+      return lhs.posts > rhs.posts;
+    }
+    return *lhs.name < *rhs.name;
+  };
+  const size_t shown = Output::is_machine() ?
+      stats.size() : min<size_t>(SHOWN_TAGS, stats.size());
+  partial_sort(stats.begin(), stats.begin() + shown, stats.end(), cmp);
+
+  if (Output::is_machine()) {
+    Output::begin_report(name,
+        {"tag", "posts", "caption_uses", "comment_uses", "percents"});
+    for (const auto& s : stats) {
+      Output::write_record({*s.name, s.posts, s.caption_uses, s.comment_uses,
+          static_cast<double>(s.caption_uses + s.comment_uses) /
+          total_uses * 100.0});
+    }
+    Output::end_report();
+    return;
+  }
+
+  cout << Term::process_colors("#{bold}> Most used " + name + " (#{gray_out}" +
+      to_string(stats.size()) + " unique, " + to_string(total_uses) +
+      " uses#{reset}#{bold}):#{reset}") << endl;
+
+  vector<Graph> graphs;
+  const Graph::Colors& colors = Graph::get_random_style();
+
+  for (size_t i = 0; i < shown; ++i) {
+    const TagStats& s = stats[i];
+    const unsigned int uses = s.caption_uses + s.comment_uses;
+
+    Graph graph;
+    graph.set_label(marker + *s.name + " - " + to_string(s.posts) + " post" +
+        (s.posts == 1 ? "" : "s") + ", " + to_string(uses) + " use" +
+        (uses == 1 ? "" : "s"));
+    graph.set_percents(static_cast<double>(uses) / total_uses * 100.0);
+    graph.set_colors(colors);
+    graph.set_bold_text(false);
+    graphs.push_back(graph);
+  }
+  Graph::draw_graphs(cout, graphs);
+}
+
+size_t Tags::find_marker(string_view t_text, size_t t_pos) {
+  static const uint64_t ONES = 0x0101010101010101ULL, HIGHS = ONES << 7;
+  static const uint64_t HASHES = ONES * '#', ATS = ONES * '@';
+
+  // Nonzero if some byte of word is equal to byte of pattern.
+  const auto& has_byte = [] (const uint64_t& t_word,
+      const uint64_t& t_pattern) {
+    const uint64_t x = t_word ^ t_pattern;
+    return (x - ONES) & ~x & HIGHS;
+  };
+
+  const char* data = t_text.data();
+  const size_t size = t_text.size();
+
+  while (t_pos < size) {
+    while (t_pos + sizeof(uint64_t) <= size) {
+      uint64_t word;
+      memcpy(&word, data + t_pos, sizeof(word));
+
+      if ((has_byte(word, HASHES) | has_byte(word, ATS)) != 0) {
+        break;
+      }
+      t_pos += sizeof(word);
+    }
+
+    // Bytes of word with marker or of the end of text.
+    const size_t end = min(t_pos + sizeof(uint64_t), size);
+    for (; t_pos < end; ++t_pos) {
+      if (data[t_pos] != '#' && data[t_pos] != '@') {
+        continue;
+      }
+
+      // Hashtags may follow each other without spaces, but mention
+      // in the middle of word (e.g. in e-mail) doesn't start token.
+      if (data[t_pos] == '#' || t_pos == 0 ||
+          !(m_classes[static_cast<uint8_t>(data[t_pos - 1])] & CLASS_WORD)) {
+        return t_pos;
+      }
+    }
+  }
+  return size;
+}
+
+size_t Tags::get_token_length(string_view t_text, size_t t_pos,
+    const Kind& t_kind) {
+  const auto& get_class = [&t_text] (const size_t& pos) {
+    return m_classes[static_cast<uint8_t>(t_text[pos])];
+  };
+  size_t end = t_pos;
+
+  if (t_kind == KIND_MENTION) {
+    while (end < t_text.size() && (get_class(end) & (CLASS_WORD | CLASS_DOT))) {
+      ++end;
+    }
+    // Dots at the end belong to sentence.
+    while (end > t_pos && t_text[end - 1] == '.') {
+      --end;
+    }
+    return end - t_pos > MAX_MENTION_LENGTH ? 0 : end - t_pos;
+  }
+
+  // Hashtag consists of letters (including non ASCII), digits and "_",
+  // but not of digits only.
+  bool has_letter = false;
+
+  while (end < t_text.size()) {
+    const uint8_t cls = get_class(end);
+
+    if (cls & CLASS_WORD) {
+      has_letter |= !(cls & CLASS_DIGIT);
+      ++end;
+      continue;
+    } else if (!(cls & (CLASS_LEAD2 | CLASS_LEAD3))) {
+      break;
+    }
+
+    const size_t len = cls & CLASS_LEAD2 ? 2 : 3;
+    bool is_valid = end + len <= t_text.size();
+    for (size_t i = 1; is_valid && i < len; ++i) {
+      is_valid = get_class(end + i) & CLASS_CONT;
+    }
+
+    if (!is_valid) {
+      break;
+    }
+    has_letter = true;
+    end += len;
+  }
+  return has_letter ? end - t_pos : 0;
+}
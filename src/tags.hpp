@@ -0,0 +1,79 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "profile.hpp"
+
+class Tags {
+public:
+  enum Kind {
+    KIND_HASHTAG,
+    KIND_MENTION
+  };
+
+  // Call "cb(kind, token)" for every hashtag and mention in UTF-8 text.
+  // Token is passed without leading "#" or "@".
+  template<typename Callback>
+  static void extract(std::string_view t_text, Callback&& t_cb) {
+    std::size_t pos = find_marker(t_text, 0);
+
+    while (pos < t_text.size()) {
+      const Kind kind = t_text[pos] == '#' ? KIND_HASHTAG : KIND_MENTION;
+      const std::size_t len = get_token_length(t_text, pos + 1, kind);
+
+      if (len != 0) {
+        t_cb(kind, t_text.substr(pos + 1, len));
+      }
+      pos = find_marker(t_text, pos + 1 + len);
+    }
+  }
+
+  // Show most used hashtags or mentions in captions and comments.
+  static void show_tags(const Profile&, const Kind&);
+
+private:
+  enum ByteClass {
+    // ASCII letter, digit or "_".
+    CLASS_WORD = 1 << 0,
+    CLASS_DIGIT = 1 << 1,
+    // Allowed in username besides word characters.
+    CLASS_DOT = 1 << 2,
+    // Lead byte of 2 or 3 bytes sequence, which may encode letter.
+    CLASS_LEAD2 = 1 << 3,
+    CLASS_LEAD3 = 1 << 4,
+    CLASS_CONT = 1 << 5
+  };
+
+  // Return position of next "#" or "@" which may start token, or size
+  // of text. Text is scanned by 8 bytes words, checking all of them
+  // for both markers at once.
+  static std::size_t find_marker(std::string_view, std::size_t pos);
+  // Return length of token which starts at "pos" (after marker).
+  static std::size_t get_token_length(
+      std::string_view, std::size_t pos, const Kind&);
+
+  static const std::array<std::uint8_t, 256> m_classes;
+  static const unsigned int MAX_MENTION_LENGTH;
+  // Count of tags, which are shown in table format.
+  static const unsigned int SHOWN_TAGS;
+};
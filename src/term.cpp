@@ -18,32 +18,27 @@
 #include "term.hpp"
 
 #include <algorithm>
+#include <cstdlib>
 #include <unistd.h>
 #include <sys/ioctl.h>
 
-#include "boost/algorithm/string/replace.hpp"
-#include "boost/regex.hpp"
-
 using namespace std;
 
 bool Term::m_is_colored;
 bool Term::m_is_dark;
 
+volatile sig_atomic_t Term::m_is_resized = true;
+unsigned int Term::m_columns = 0;
+string Term::m_clear_line;
+
 const set<string> Term::m_colored_terms = {
   "ansi", "color", "console", "cygwin", "gnome", "konsole", "kterm",
   "linux", "msys", "putty", "rxvt", "screen", "vt100", "xterm"
 };
 
-const map<Term::Color, Term::ColorInfo> Term::m_colors = {
-  {COL_WHITE, {"white", 255, 231}}, {COL_RED, {"red", 197, 197}},
-  {COL_ORANGE, {"orange", 208, 202}}, {COL_YELLOW, {"yellow", 220, 214}},
-  {COL_CREAM, {"cream", 223, 218}}, {COL_GREEN, {"green", 42, 40}},
-  {COL_BLUE, {"blue", 33, 27}}, {COL_GRAY, {"gray", 250, 245}},
-  {COL_BLACK, {"black", 235, 232}}
-};
-
 void Term::init(const bool& t_is_dark) {
   m_is_colored = is_colored();
+  m_is_resized = true;
   set_dark_theme(t_is_dark);
 }
 
@@ -54,49 +49,90 @@ bool Term::is_colored() {
 }
 
 unsigned int Term::get_columns() {
-  struct winsize ws;
-  ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws);
-  return ws.ws_col;
-}
+  static bool is_handler_set = false;
+  if (!is_handler_set) {
+    struct sigaction action = {};
+    action.sa_handler = on_resize;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+
+    sigaction(SIGWINCH, &action, nullptr);
+    is_handler_set = true;
+  }
 
-string Term::process_colors(string str) {
-  using namespace boost;
+  if (m_is_resized) {
+    m_is_resized = false;
 
-  if (!m_is_colored) {
-    str = regex_replace(str, regex("#\\{[[:alpha:]_]+\\}"), "");
-  } else {
-    const map<string, string> marks = {
-      {"bold", bold()}, {"reset", reset()}
-    };
-    const map<string, string> color_types = {
-      {"_out", "\x1b[38;5;"}, {"_fill", "\x1b[48;5;"}
-    };
-
-    // Replace colors.
-    for (const auto& c : m_colors) {
-      for (const auto& t : color_types) {
-        const string& mark = "#{" + c.second.name + t.first + "}";
-        const string& code = t.second + to_string(m_is_dark ?
-            c.second.code_dark : c.second.code_light) + "m";
-        ireplace_all(str, mark, code);
-      }
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col != 0) {
+      m_columns = ws.ws_col;
+    } else {
+      static const unsigned int DEFAULT_COLUMNS = 80;
+      m_columns = DEFAULT_COLUMNS;
     }
+  }
+  return m_columns;
+}
 
-    // Process additional marks.
-    for (const auto& m : marks) {
-      ireplace_all(str, "#{" + m.first + "}", m.second);
-    }
+const string& Term::clear_line() {
+  if (m_is_colored) {
+    static const string erase_line = "\r\x1b[2K" + reset();
+    return erase_line;
+  }
+
+  const unsigned int columns = get_columns();
+  if (m_clear_line.size() != columns + 2) {
+    m_clear_line = '\r' + string(columns, ' ') + '\r';
+  }
+  return m_clear_line;
+}
+
+void Term::on_resize(int) {
+  m_is_resized = true;
+}
+
+string Term::process_colors(const string& t_str) {
+  string str;
+  str.reserve(t_str.size());
+
+  for (size_t pos = 0; pos < t_str.size();) {
+    const Token& token = next_token(t_str, pos);
+    append_token(str, t_str, token);
+    pos += token.length;
   }
   return str;
 }
 
+void Term::append_token(string& t_out, string_view t_markup,
+    const Token& t_token) {
+  switch (t_token.mark) {
+    case MARK_TEXT:
+      t_out.append(t_markup, t_token.begin, t_token.length);
+      return;
+    case MARK_UNKNOWN:
+      if (m_is_colored) {
+        t_out.append(t_markup, t_token.begin, t_token.length);
+      }
+      return;
+    case MARK_BOLD:
+      t_out += bold();
+      return;
+    case MARK_RESET:
+      t_out += reset();
+      return;
+    default:
+      t_out += get_color(static_cast<Color>(t_token.mark / 2),
+          t_token.mark % 2 != 0);
+  }
+}
+
 string Term::get_color(const Color& col, const bool& is_fill) {
   if (!m_is_colored) {
     return "";
   }
 
   const string& code = is_fill ? "\x1b[48;5;" : "\x1b[38;5;";
-  const ColorInfo& data = m_colors.at(col);
+  const ColorInfo& data = m_colors[col];
   return code +
       to_string(m_is_dark ? data.code_dark : data.code_light) + 'm';
 }
@@ -17,9 +17,12 @@
 
 #pragma once
 
-#include <map>
+#include <array>
+#include <csignal>
+#include <cstddef>
 #include <set>
 #include <string>
+#include <string_view>
 
 class Term {
 public:
@@ -36,14 +39,60 @@ public:
   };
 
   struct ColorInfo {
-    std::string name;
+    std::string_view name;
     // ESC codes for light and dark terminals.
     unsigned int code_dark;
     unsigned int code_light;
   };
 
+  // Part of markup: plain text or mark (see "process_colors").
+  struct Token {
+    std::size_t begin, length;
+    // One of MARK_* constants or "color * 2 + is_fill".
+    int mark;
+  };
+
+  static constexpr int MARK_TEXT = -1;
+  // Unknown mark, removed only if colors disabled.
+  static constexpr int MARK_UNKNOWN = -2;
+  static constexpr int MARK_BOLD = COL_BLACK * 2 + 2;
+  static constexpr int MARK_RESET = MARK_BOLD + 1;
+
+  // Markup parsed at compile time, e.g.:
+  //   static constexpr Term::Markup title("#{bold}Title#{reset}");
+  //   cout << title.str();
+  template<std::size_t N>
+  class Markup {
+  public:
+    constexpr Markup(const char (&t_str)[N]) {
+      for (std::size_t i = 0; i < N; ++i) {
+        m_text[i] = t_str[i];
+      }
+
+      const std::string_view str(m_text, N - 1);
+      for (std::size_t pos = 0; pos < str.size(); ++m_count) {
+        m_tokens[m_count] = next_token(str, pos);
+        pos += m_tokens[m_count].length;
+      }
+    }
+
+    std::string str() const {
+      std::string str;
+      for (std::size_t i = 0; i < m_count; ++i) {
+        append_token(str, std::string_view(m_text, N - 1), m_tokens[i]);
+      }
+      return str;
+    }
+
+  private:
+    char m_text[N] = {};
+    std::array<Token, N> m_tokens = {};
+    std::size_t m_count = 0;
+  };
+
   static void init(const bool& is_dark);
   static bool is_colored();
+  // Size is cached and requested again only after SIGWINCH.
   static unsigned int get_columns();
 
   inline static void set_dark_theme(const bool& t_is_dark) {
@@ -58,19 +107,101 @@ public:
   // Also available following marks:
   // #{bold} - set text to bold;
   // #{reset} - reset all colors and font style.
-  static std::string process_colors(std::string);
+  //
+  // String is processed in one pass without regular expressions.
+  // For string literals use "Markup", which is parsed at compile time.
+  static std::string process_colors(const std::string&);
   static std::string get_color(const Color&, const bool& is_fill = false);
   static std::string reset();
   static std::string bold();
 
-  inline static std::string clear_line() {
-    return '\r' + std::string(get_columns(), ' ') + '\r' + reset();
-  };
+  // Use ANSI erase sequence if colors supported, otherwise fill line
+  // with spaces. Returned string is cached.
+  static const std::string& clear_line();
+
+  // Return token which starts at "pos".
+  static constexpr Token next_token(std::string_view str, std::size_t pos) {
+    if (str.substr(pos, 2) == "#{") {
+      const std::size_t close = str.find('}', pos + 2);
+      const std::size_t len = close == std::string_view::npos ?
+          0 : close - pos - 2;
+      bool is_mark = len != 0;
+
+      for (std::size_t i = pos + 2; is_mark && i < pos + 2 + len; ++i) {
+        const char c = str[i];
+        is_mark = c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+      }
+
+      if (is_mark) {
+        return {pos, len + 3, find_mark(str.substr(pos + 2, len))};
+      }
+    }
+
+    std::size_t next = str.find("#{", pos + 1);
+    if (next == std::string_view::npos) {
+      next = str.size();
+    }
+    return {pos, next - pos, MARK_TEXT};
+  }
+
+  // Case-insensitive search of mark by name.
+  static constexpr int find_mark(std::string_view name) {
+    const auto& equal = [] (std::string_view lhs, std::string_view rhs) {
+      if (lhs.size() != rhs.size()) {
+        return false;
+      }
+      for (std::size_t i = 0; i < lhs.size(); ++i) {
+        const char c = (lhs[i] >= 'A' && lhs[i] <= 'Z') ?
+            lhs[i] - 'A' + 'a' : lhs[i];
+        if (c != rhs[i]) {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    if (equal(name, "bold")) {
+      return MARK_BOLD;
+    } else if (equal(name, "reset")) {
+      return MARK_RESET;
+    }
+
+    for (std::size_t c = 0; c < m_colors.size(); ++c) {
+      const std::string_view color = m_colors[c].name;
+      if (name.size() <= color.size() ||
+          !equal(name.substr(0, color.size()), color)) {
+        continue;
+      }
+
+      const std::string_view type = name.substr(color.size());
+      if (equal(type, "_out")) {
+        return c * 2;
+      } else if (equal(type, "_fill")) {
+        return c * 2 + 1;
+      }
+    }
+    return MARK_UNKNOWN;
+  }
+
+  static void append_token(
+      std::string& out, std::string_view markup, const Token&);
 
 private:
   static const std::set<std::string> m_colored_terms;
-  static const std::map<Color, ColorInfo> m_colors;
+
+  // Indexes are equal to "Color" values.
+  static constexpr std::array<ColorInfo, COL_BLACK + 1> m_colors = {{
+    {"white", 255, 231}, {"red", 197, 197}, {"orange", 208, 202},
+    {"yellow", 220, 214}, {"cream", 223, 218}, {"green", 42, 40},
+    {"blue", 33, 27}, {"gray", 250, 245}, {"black", 235, 232}
+  }};
+
+  static void on_resize(int);
 
   static bool m_is_colored;
   static bool m_is_dark;
+
+  static volatile std::sig_atomic_t m_is_resized;
+  static unsigned int m_columns;
+  static std::string m_clear_line;
 };
@@ -0,0 +1,173 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "timings.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "term.hpp"
+
+using namespace std;
+using namespace std::chrono;
+
+const array<const char*, Timings::PHASE_COUNT> Timings::m_names = {
+  "Python processes", "Posts loading", "Comments extraction",
+  "Coordinates collecting", "Geocoding requests", "Graphs rendering",
+  "Commentator lookup"
+};
+
+array<Timings::Stats, Timings::PHASE_COUNT> Timings::m_stats;
+array<Timings::MemoryStats, Timings::PHASE_COUNT> Timings::m_memory_stats;
+steady_clock::time_point Timings::m_start;
+bool Timings::m_is_enabled = false;
+
+void Timings::set_enabled(const bool& t_is_enabled) {
+  static bool is_registered = false;
+  if (t_is_enabled && !is_registered) {
+    atexit(print_report);
+    is_registered = true;
+  }
+
+  if (t_is_enabled && !m_is_enabled) {
+    m_start = steady_clock::now();
+  }
+  m_is_enabled = t_is_enabled;
+}
+
+void Timings::set_memory_enabled(const bool& t_is_enabled) {
+  static bool is_registered = false;
+  if (t_is_enabled && !is_registered) {
+    atexit(print_memory_report);
+    is_registered = true;
+  }
+  Memory::set_enabled(t_is_enabled);
+}
+
+nanoseconds Timings::get_cpu_time() {
+  timespec ts;
+  if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) {
+    return nanoseconds(0);
+  }
+  return seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec);
+}
+
+void Timings::add(const Phase& t_phase, const nanoseconds& t_wall,
+    const nanoseconds& t_cpu) {
+  Stats& stats = m_stats[t_phase];
+  stats.wall += t_wall;
+  stats.cpu += t_cpu;
+  ++stats.calls;
+}
+
+void Timings::add_memory(const Phase& t_phase,
+    const Memory::Counters& t_start, const int64_t& t_outer_peak) {
+  const Memory::Counters& end = Memory::get_counters();
+  MemoryStats& stats = m_memory_stats[t_phase];
+
+  stats.allocs += end.allocs - t_start.allocs;
+  stats.bytes += end.bytes - t_start.bytes;
+  stats.peak = max(stats.peak, Memory::get_peak() - t_start.live);
+  stats.retained = max(stats.retained, end.live - t_start.live);
+  stats.rss = max(stats.rss, Memory::get_rss());
+  ++stats.calls;
+  // Peak of outer phase includes peak of this one.
+  Memory::merge_peak(t_outer_peak);
+}
+
+void Timings::print_report() {
+  if (!m_is_enabled) {
+    return;
+  }
+
+  const auto& to_ms = [] (const nanoseconds& t_time) {
+    return duration<double, milli>(t_time).count();
+  };
+
+  char line[128];
+  snprintf(line, sizeof(line), "  %-24s %8s %12s %12s\n",
+      "Phase", "Calls", "Wall, ms", "CPU, ms");
+  string report = Term::process_colors("#{bold}Timings (phases may be "
+      "nested, CPU time is of this process only):#{reset}\n") + line;
+
+  for (size_t p = 0; p < m_stats.size(); ++p) {
+    if (m_stats[p].calls == 0) {
+      continue;
+    }
+
+    snprintf(line, sizeof(line), "  %-24s %8lu %12.1f %12.1f\n", m_names[p],
+        m_stats[p].calls, to_ms(m_stats[p].wall), to_ms(m_stats[p].cpu));
+    report += line;
+  }
+
+  snprintf(line, sizeof(line), "  %-24s %8s %12.1f %12.1f\n", "Total", "",
+      to_ms(steady_clock::now() - m_start), to_ms(get_cpu_time()));
+  report += Term::bold() + line + Term::reset();
+  cerr << report << flush;
+}
+
+void Timings::print_memory_report() {
+  if (!Memory::is_enabled()) {
+    return;
+  }
+
+  const auto& to_mb = [] (const double& t_bytes) {
+    return t_bytes / (1024 * 1024);
+  };
+
+  char line[160];
+  snprintf(line, sizeof(line), "  %-24s %8s %10s %12s %10s %12s %10s\n",
+      "Phase", "Calls", "Allocs", "Alloc., MB", "Peak, MB", "Retained, MB",
+      "RSS, MB");
+  string report = Term::process_colors("#{bold}Memory (phases may be "
+      "nested, peak and retained are maximums of calls):#{reset}\n") + line;
+
+  size_t max_phase = PHASE_COUNT;
+  for (size_t p = 0; p < m_memory_stats.size(); ++p) {
+    const MemoryStats& stats = m_memory_stats[p];
+    if (stats.calls == 0) {
+      continue;
+    }
+    if (max_phase == PHASE_COUNT ||
+        stats.peak > m_memory_stats[max_phase].peak) {
+      max_phase = p;
+    }
+
+    snprintf(line, sizeof(line),
+        "  %-24s %8lu %10lu %12.1f %10.1f %12.1f %10.1f\n", m_names[p],
+        stats.calls, static_cast<unsigned long>(stats.allocs),
+        to_mb(stats.bytes), to_mb(stats.peak), to_mb(stats.retained),
+        to_mb(stats.rss));
+    report += line;
+  }
+
+  const Memory::Counters& total = Memory::get_counters();
+  snprintf(line, sizeof(line), "  %-24s %8s %10lu %12.1f %10.1f %12s %10.1f\n",
+      "Total", "", static_cast<unsigned long>(total.allocs),
+      to_mb(total.bytes), to_mb(Memory::get_peak()), "",
+      to_mb(Memory::get_peak_rss()));
+  report += Term::bold() + line + Term::reset();
+
+  if (max_phase != PHASE_COUNT) {
+    report += Term::process_colors("Most memory is held by phase #{bold}") +
+        m_names[max_phase] + Term::reset() + '\n';
+  }
+  cerr << report << flush;
+}
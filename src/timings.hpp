@@ -0,0 +1,119 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+#include "memory.hpp"
+#include "trace.hpp"
+
+class Timings {
+public:
+  enum Phase {
+    PHASE_INTERPRETER,
+    PHASE_POSTS,
+    PHASE_COMMENTS,
+    PHASE_COORDS,
+    PHASE_GEOCODING,
+    PHASE_GRAPHS,
+    PHASE_COMMENTATOR,
+    PHASE_COUNT
+  };
+
+  // Measure time and memory of scope as phase, which is also recorded
+  // to trace. If timings, memory report and trace are disabled, nothing
+  // but flags is checked.
+  class Scope {
+  public:
+    explicit Scope(const Phase& t_phase): m_trace(m_names[t_phase]),
+        m_phase(t_phase) {
+      if (m_is_enabled) {
+        m_wall_start = std::chrono::steady_clock::now();
+        m_cpu_start = get_cpu_time();
+        m_is_active = true;
+      }
+      if (Memory::is_enabled()) {
+        m_mem_start = Memory::get_counters();
+        m_outer_peak = Memory::reset_peak();
+        m_is_mem_active = true;
+      }
+    }
+    ~Scope() {
+      if (m_is_active) {
+        add(m_phase, std::chrono::steady_clock::now() - m_wall_start,
+            get_cpu_time() - m_cpu_start);
+      }
+      if (m_is_mem_active) {
+        add_memory(m_phase, m_mem_start, m_outer_peak);
+      }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    const Trace::Scope m_trace;
+    Phase m_phase;
+    bool m_is_active = false, m_is_mem_active = false;
+    std::chrono::steady_clock::time_point m_wall_start;
+    std::chrono::nanoseconds m_cpu_start;
+    Memory::Counters m_mem_start;
+    std::int64_t m_outer_peak;
+  };
+
+  // Report is printed to stderr at exit.
+  static void set_enabled(const bool&);
+  inline static bool is_enabled() { return m_is_enabled; }
+  // Count allocations in phases and print their report at exit.
+  static void set_memory_enabled(const bool&);
+
+private:
+  struct Stats {
+    std::chrono::nanoseconds wall{0}, cpu{0};
+    unsigned long calls = 0;
+  };
+
+  struct MemoryStats {
+    std::uint64_t allocs = 0, bytes = 0;
+    // Maximum of live bytes above start of phase, and of live bytes
+    // left after phase (held by results and caches).
+    std::int64_t peak = 0, retained = 0;
+    // Maximum of RSS at end of phase.
+    std::size_t rss = 0;
+    unsigned long calls = 0;
+  };
+
+  // CPU time of this process (without child processes).
+  static std::chrono::nanoseconds get_cpu_time();
+  static void add(const Phase&, const std::chrono::nanoseconds& wall,
+      const std::chrono::nanoseconds& cpu);
+  static void add_memory(const Phase&, const Memory::Counters& start,
+      const std::int64_t& outer_peak);
+  static void print_report();
+  static void print_memory_report();
+
+  static const std::array<const char*, PHASE_COUNT> m_names;
+  static std::array<Stats, PHASE_COUNT> m_stats;
+  static std::array<MemoryStats, PHASE_COUNT> m_memory_stats;
+  static std::chrono::steady_clock::time_point m_start;
+  static bool m_is_enabled;
+};
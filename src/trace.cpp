@@ -0,0 +1,125 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "trace.hpp"
+
+#include <cstdlib>
+#include <fstream>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "nlohmann/json.hpp"
+
+#include "instanalyzer.hpp"
+
+using namespace nlohmann;
+using namespace std;
+using namespace std::chrono;
+
+vector<unique_ptr<Trace::Buffer>> Trace::m_buffers;
+mutex Trace::m_buffers_mutex;
+filesystem::path Trace::m_path;
+steady_clock::time_point Trace::m_start;
+atomic<unsigned long> Trace::m_last_async_id(0);
+bool Trace::m_is_enabled = false;
+
+void Trace::set_output(const filesystem::path& t_path) {
+  if (!m_is_enabled) {
+    atexit(write);
+    m_start = steady_clock::now();
+  }
+
+  m_path = filesystem::absolute(t_path);
+  m_is_enabled = true;
+}
+
+void Trace::on_fork() {
+  if (!m_is_enabled) {
+    return;
+  }
+
+  // Only forking thread exists in child, so buffers aren't locked.
+  for (const auto& b : m_buffers) {
+    b->events.clear();
+    b->tid = syscall(SYS_gettid);
+  }
+  m_path.replace_filename(m_path.stem().string() + '.' +
+      to_string(getpid()) + m_path.extension().string());
+}
+
+unsigned long Trace::begin_async(const char* t_name) {
+  if (!m_is_enabled) {
+    return 0;
+  }
+
+  const unsigned long id = ++m_last_async_id;
+  record('b', t_name, id);
+  return id;
+}
+
+void Trace::end_async(const char* t_name, const unsigned long& t_id) {
+  if (m_is_enabled) {
+    record('e', t_name, t_id);
+  }
+}
+
+void Trace::record(const char& t_type, const char* t_name,
+    const unsigned long& t_id) {
+  get_buffer().events.push_back(
+      {t_name, steady_clock::now() - m_start, t_id, t_type});
+}
+
+Trace::Buffer& Trace::get_buffer() {
+  // Buffers are owned by list, so they outlive their threads.
+  thread_local Buffer* buffer = nullptr;
+
+  if (buffer == nullptr) {
+    lock_guard<mutex> lock(m_buffers_mutex);
+    m_buffers.push_back(make_unique<Buffer>());
+    buffer = m_buffers.back().get();
+    buffer->tid = syscall(SYS_gettid);
+  }
+  return *buffer;
+}
+
+void Trace::write() {
+  lock_guard<mutex> lock(m_buffers_mutex);
+  const pid_t pid = getpid();
+  json events = json::array();
+
+  for (const auto& b : m_buffers) {
+    for (const auto& e : b->events) {
+      json event = {
+        {"name", e.name}, {"cat", "instanalyzer"}, {"ph", string(1, e.type)},
+        {"ts", duration<double, micro>(e.time).count()},
+        {"pid", pid}, {"tid", b->tid}
+      };
+      if (e.type == 'b' || e.type == 'e') {
+        event["id"] = e.id;
+      }
+      events.push_back(move(event));
+    }
+  }
+
+  ofstream ofs(m_path);
+  ofs << json({{"traceEvents", events}, {"displayTimeUnit", "ms"}}) << endl;
+  if (!ofs) {
+    Instanalyzer::msg(Instanalyzer::MSG_ERR,
+        "Unable to write trace to \"" + m_path.string() + "\"!");
+  }
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Recording of events in format of Chrome trace viewer. Every thread
+// appends events to own buffer, so recording doesn't take locks.
+class Trace {
+public:
+  // Record begin and end of scope. Name must be string literal.
+  class Scope {
+  public:
+    explicit Scope(const char* t_name): m_name(t_name) {
+      if (m_is_enabled) {
+        record('B', m_name);
+        m_is_active = true;
+      }
+    }
+    ~Scope() {
+      if (m_is_active) {
+        record('E', m_name);
+      }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    const char* m_name;
+    bool m_is_active = false;
+  };
+
+  // Events are written to file at exit.
+  static void set_output(const std::filesystem::path&);
+  inline static bool is_enabled() { return m_is_enabled; }
+  // Forked process drops events of parent and writes own ones to file
+  // with its pid in name (e.g. "trace.1234.json"), so parent's file
+  // isn't overwritten.
+  static void on_fork();
+
+  // Span which isn't bound to scope (e.g. of child process),
+  // returns its identifier for end.
+  static unsigned long begin_async(const char* name);
+  static void end_async(const char* name, const unsigned long& id);
+
+private:
+  struct Event {
+    const char* name;
+    std::chrono::steady_clock::duration time;
+    unsigned long id;
+    char type;
+  };
+
+  struct Buffer {
+    long tid;
+    std::vector<Event> events;
+  };
+
+  static void record(const char& type, const char* name,
+      const unsigned long& id = 0);
+  static Buffer& get_buffer();
+  static void write();
+
+  static std::vector<std::unique_ptr<Buffer>> m_buffers;
+  static std::mutex m_buffers_mutex;
+  static std::filesystem::path m_path;
+  static std::chrono::steady_clock::time_point m_start;
+  static std::atomic<unsigned long> m_last_async_id;
+  static bool m_is_enabled;
+};
@@ -17,6 +17,12 @@
 
 #include "utils.hpp"
 
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <unistd.h>
+
 using namespace nlohmann;
 using namespace std;
 
@@ -30,3 +36,37 @@ bool Utils::has_json_node(json t_json, const vector<string>& t_node) {
   }
   return true;
 }
+
+uint64_t Utils::get_checksum(const string& t_data) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (const auto& c : t_data) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+void Utils::write_file(const filesystem::path& t_path, const string& t_data) {
+  {
+    ifstream ifs(t_path, ios::binary);
+    if (ifs.is_open() && string(istreambuf_iterator<char>(ifs),
+        istreambuf_iterator<char>()) == t_data) {
+      return;
+    }
+  }
+
+  // Temporary file is unique for process, because others may write
+  // the same file at once.
+  filesystem::path tmp_path = t_path;
+  tmp_path += ".tmp." + to_string(getpid());
+  ofstream ofs(tmp_path, ios::binary);
+  ofs << t_data;
+  ofs.close();
+
+  if (ofs.fail()) {
+    error_code e;
+    filesystem::remove(tmp_path, e);
+    throw runtime_error("File (" + t_path.string() + ") didn't write!");
+  }
+  filesystem::rename(tmp_path, t_path);
+}
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <filesystem>
 #include <string>
 #include <vector>
 
@@ -25,4 +27,10 @@
 class Utils {
 public:
   static bool has_json_node(nlohmann::json, const std::vector<std::string>&);
+  // FNV-1a hash, which doesn't depend on standard library implementation.
+  static std::uint64_t get_checksum(const std::string&);
+  // Replace file by temporary one, so readers never see it partially
+  // written. File with the same content isn't touched.
+  static void write_file(const std::filesystem::path&, const std::string& data)
+      noexcept(false);
 };
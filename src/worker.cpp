@@ -0,0 +1,371 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "worker.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "boost/process.hpp"
+
+#include "reactor.hpp"
+#include "term.hpp"
+#include "utils.hpp"
+
+using namespace nlohmann;
+using namespace std;
+
+struct Worker::Process {
+  boost::process::opstream in;
+  boost::process::ipstream out;
+  boost::process::child child;
+};
+
+const string Worker::m_script = R"(import json
+import sys
+
+import instaloader
+
+current_id = None
+loader = None
+
+
+def emit(event, **fields):
+    fields['event'] = event
+    if current_id is not None:
+        fields['id'] = current_id
+    sys.stdout.write(json.dumps(fields) + '\n')
+    sys.stdout.flush()
+
+
+def exception_kind(e):
+    kinds = [
+        ('not_exists', 'ProfileNotExistsException'),
+        ('private', 'PrivateProfileNotFollowedException'),
+        ('private', 'LoginRequiredException'),
+        ('connection', 'ConnectionException')
+    ]
+    for kind, name in kinds:
+        cls = getattr(instaloader, name, None)
+        if cls is not None and isinstance(e, cls):
+            return kind
+    return 'other'
+
+
+def on_context_error(msg, repeat_at_end=True):
+    kind = 'connection' if 'Max retries exceeded' in msg else 'other'
+    emit('error', kind=kind, critical=False, message=msg)
+
+
+def get_loader(req):
+    global loader
+    if loader is None:
+        loader = instaloader.Instaloader(
+            quiet=True, download_pictures=False, download_videos=False,
+            download_video_thumbnails=False, download_geotags=True,
+            download_comments=True, save_metadata=True, compress_json=False,
+            post_metadata_txt_pattern='',
+            max_connection_attempts=req.get('max_connection_attempts', 3))
+        loader.context.error = on_context_error
+    loader.filename_pattern = req.get('filename_pattern', '{shortcode}')
+    loader.dirname_pattern = req.get('dirname_pattern', '{target}')
+    return loader
+
+
+def download(req):
+    ldr = get_loader(req)
+    profile = instaloader.Profile.from_username(ldr.context, req['profile'])
+    total = profile.mediacount
+    current = [0]
+
+    def download_post(post, target):
+        current[0] += 1
+        emit('progress', current=current[0], total=total)
+        return type(ldr).download_post(ldr, post, target)
+
+    ldr.download_post = download_post
+    try:
+        ldr.download_profiles({profile}, profile_pic=False, raise_errors=True)
+    finally:
+        del ldr.download_post
+
+
+def main():
+    global current_id
+    emit('ready', version=instaloader.__version__)
+
+    for line in sys.stdin:
+        try:
+            req = json.loads(line)
+        except ValueError:
+            continue
+        current_id = req.get('id')
+        cmd = req.get('cmd')
+
+        try:
+            if cmd == 'exit':
+                emit('done', ok=True)
+                return
+            elif cmd == 'version':
+                emit('done', ok=True, result=instaloader.__version__)
+            elif cmd == 'download':
+                download(req)
+                emit('done', ok=True)
+            else:
+                raise ValueError('unknown command: ' + str(cmd))
+        except Exception as e:
+            emit('error', kind=exception_kind(e), critical=True,
+                 profile=req.get('profile', ''), message=str(e))
+            emit('done', ok=False)
+        finally:
+            current_id = None
+
+
+main()
+)";
+
+unique_ptr<Worker::Process> Worker::m_process;
+pid_t Worker::m_owner_pid = 0;
+vector<shared_ptr<Worker::PoolWorker>> Worker::m_pool;
+unsigned long Worker::m_last_id = 0;
+bool Worker::m_is_enabled = false;
+bool Worker::m_is_script_written = false;
+
+void Worker::start() {
+  using namespace boost::process;
+
+  if (m_process != nullptr) {
+    // Worker of parent process isn't child of this one, so it can't
+    // be waited.
+    const bool is_owner = getpid() == m_owner_pid;
+    if (is_owner ? m_process->child.running() :
+        kill(m_process->child.id(), 0) == 0) {
+      return;
+    } else if (!is_owner) {
+      m_process->child.detach();
+    }
+  }
+
+  write_script();
+  m_process = make_unique<Process>();
+  m_owner_pid = getpid();
+  m_process->child = child(Modules::get_interpreter_path().string(), "-u",
+      get_script_path().string(), std_in < m_process->in,
+      std_out > m_process->out, std_err > null);
+
+  string line;
+  while (getline(m_process->out, line)) {
+    try {
+      if (json::parse(line).value("event", "") == "ready") {
+        static bool is_registered = false;
+        if (!is_registered) {
+          atexit(stop);
+          is_registered = true;
+        }
+        return;
+      }
+    } catch (const json::exception&) {}
+  }
+
+  m_process.reset();
+  throw runtime_error(Term::process_colors("#{bold}Instaloader#{reset} "
+      "worker didn't start! Try to update modules."));
+}
+
+void Worker::stop() {
+  if (m_process == nullptr) {
+    return;
+  }
+
+  // Worker of parent process keeps running for others.
+  if (getpid() != m_owner_pid) {
+    m_process->child.detach();
+    m_process.reset();
+    return;
+  }
+
+  if (m_process->child.running()) {
+    m_process->in << json({{"cmd", "exit"}}).dump() << endl;
+    m_process->in.pipe().close();
+
+    if (!m_process->child.wait_for(chrono::seconds(1))) {
+      m_process->child.terminate();
+    }
+  }
+  m_process.reset();
+}
+
+json Worker::request(json t_command, const event_cb& t_cb) {
+  start();
+
+  // Commands of processes, which share worker, mustn't interleave. Lock
+  // file is opened by every process, because forked descriptor would
+  // share lock with parent.
+  int lock_fd = -1;
+  if (getpid() != m_owner_pid) {
+    lock_fd = open(get_lock_path().c_str(), O_RDWR | O_CREAT | O_CLOEXEC,
+        0600);
+    while (lock_fd != -1 && flock(lock_fd, LOCK_EX) != 0 && errno == EINTR) {}
+  }
+  struct Unlock {
+    int fd;
+    ~Unlock() {
+      if (fd != -1) {
+        close(fd);
+      }
+    }
+  } unlock{lock_fd};
+
+  // Identifiers are unique between processes, so events of command,
+  // which is interrupted in other process, are skipped.
+  const unsigned long id = static_cast<unsigned long>(getpid()) << 32 |
+      ++m_last_id;
+  t_command["id"] = id;
+  m_process->in << t_command.dump() << endl;
+
+  string line;
+  while (getline(m_process->out, line)) {
+    json event;
+    try {
+      event = json::parse(line);
+    } catch (const json::exception&) {
+      continue;
+    }
+
+    if (event.value("id", 0UL) != id) {
+      continue;
+    } else if (event.value("event", "") == "done") {
+      return event;
+    } else if (t_cb != nullptr) {
+      t_cb(event);
+    }
+  }
+
+  m_process.reset();
+  throw runtime_error(Term::process_colors("#{bold}Instaloader#{reset} "
+      "worker stopped unexpectedly!"));
+}
+
+void Worker::request_async(json t_command, const event_cb& t_cb_event,
+    const event_cb& t_cb_done) {
+  auto worker = find_if(m_pool.begin(), m_pool.end(),
+      [] (const shared_ptr<PoolWorker>& t_worker) {
+    return t_worker->request_id == 0;
+  });
+
+  if (worker == m_pool.end()) {
+    write_script();
+    const auto& pool_worker = make_shared<PoolWorker>();
+
+    // Callbacks hold weak pointer, because worker is removed from pool
+    // on exit and process is removed from Reactor after callback.
+    const auto& fout = [weak = weak_ptr<PoolWorker>(pool_worker)]
+        (const string& t_line) {
+      const auto& w = weak.lock();
+      json event;
+      try {
+        event = json::parse(t_line);
+      } catch (const json::exception&) {
+        return;
+      }
+
+      if (w == nullptr || w->request_id == 0 ||
+          event.value("id", 0UL) != w->request_id) {
+        return;
+      } else if (event.value("event", "") != "done") {
+        if (w->cb_event != nullptr) {
+          w->cb_event(event);
+        }
+        return;
+      }
+
+      // Worker is idle before callback, so it may send next command.
+      const event_cb cb_done = w->cb_done;
+      w->request_id = 0;
+      w->cb_event = w->cb_done = nullptr;
+      cb_done(event);
+    };
+
+    const auto& fexit = [weak = weak_ptr<PoolWorker>(pool_worker)]
+        (const int) {
+      const auto& w = weak.lock();
+      if (w == nullptr) {
+        return;
+      }
+      m_pool.erase(remove(m_pool.begin(), m_pool.end(), w), m_pool.end());
+
+      if (w->request_id != 0 && w->cb_done != nullptr) {
+        w->cb_done({{"event", "done"}, {"ok", false},
+            {"message", Term::process_colors("#{bold}Instaloader#{reset} "
+            "worker stopped unexpectedly!")}});
+      }
+    };
+
+    pool_worker->request_id = 0;
+    pool_worker->process_id = Reactor::spawn(
+        Modules::get_interpreter_path().string() + " -u " +
+        get_script_path().string(), fout, nullptr, fexit, true);
+    m_pool.push_back(pool_worker);
+    worker = m_pool.end() - 1;
+
+    static bool is_registered = false;
+    if (!is_registered) {
+      atexit(stop_pool);
+      is_registered = true;
+    }
+  }
+
+  PoolWorker& w = **worker;
+  w.request_id = ++m_last_id;
+  w.cb_event = t_cb_event;
+  w.cb_done = t_cb_done;
+  t_command["id"] = w.request_id;
+
+  try {
+    Reactor::write(w.process_id, t_command.dump() + '\n');
+  } catch (const exception&) {
+    w.request_id = 0;
+    w.cb_event = w.cb_done = nullptr;
+    throw;
+  }
+}
+
+void Worker::stop_pool() {
+  // Busy workers finish current command, but its result is dropped.
+  for (const auto& w : m_pool) {
+    Reactor::close_input(w->process_id);
+  }
+  m_pool.clear();
+}
+
+void Worker::write_script() {
+  if (m_is_script_written) {
+    return;
+  }
+
+  Instanalyzer::require(Instanalyzer::SUB_MODULES);
+  Utils::write_file(get_script_path(), m_script);
+  m_is_script_written = true;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright © 2019 Nikita Dudko. All rights reserved.
+ * Contacts: <nikita.dudko.95@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "nlohmann/json.hpp"
+
+#include "modules.hpp"
+
+// Persistent Python process which imports Instaloader once and then
+// executes commands. Every command is a JSON object on a separate line;
+// worker replies with events in the same format:
+//   {"id": 1, "event": "progress", "current": 5, "total": 20}
+//   {"id": 1, "event": "error", "kind": "private", "critical": true, ...}
+//   {"id": 1, "event": "done", "ok": true, "result": ...}
+class Worker {
+public:
+  // Callback for every event of command (except "done" for "request").
+  typedef std::function<void(const nlohmann::json&)> event_cb;
+
+  inline static bool is_enabled() { return m_is_enabled; }
+  inline static void set_enabled(const bool& t_enabled) {
+    m_is_enabled = t_enabled;
+  }
+
+  // Start worker if it isn't running yet. Worker is shared with forked
+  // processes (e.g. requests of daemon), which take lock for commands.
+  static void start() noexcept(false);
+  static void stop();
+
+  // Send command and wait for its completion.
+  // Return "done" event of command.
+  static nlohmann::json request(nlohmann::json command,
+      const event_cb& cb = nullptr) noexcept(false);
+
+  // Send command to idle worker of pool, which is started if all are
+  // busy, so count of workers doesn't exceed count of parallel commands.
+  // Callbacks are called while Reactor dispatches events. If worker
+  // stopped unexpectedly, "cb_done" gets {"ok": false, "message": ...}.
+  static void request_async(nlohmann::json command, const event_cb& cb_event,
+      const event_cb& cb_done) noexcept(false);
+  // Let workers of pool finish after their commands.
+  static void stop_pool();
+
+  inline static std::filesystem::path get_script_path() {
+    return Modules::get_modules_path() / "instanalyzer_worker.py";
+  }
+  inline static std::filesystem::path get_lock_path() {
+    return Instanalyzer::get_work_path() / "worker.lock";
+  }
+
+private:
+  struct Process;
+
+  struct PoolWorker {
+    unsigned long process_id;
+    // Zero if worker is idle.
+    unsigned long request_id;
+    event_cb cb_event, cb_done;
+  };
+
+  // Script is written once per run.
+  static void write_script() noexcept(false);
+
+  static const std::string m_script;
+  static std::unique_ptr<Process> m_process;
+  // Process which started worker, others only use it.
+  static pid_t m_owner_pid;
+  static std::vector<std::shared_ptr<PoolWorker>> m_pool;
+  static unsigned long m_last_id;
+  static bool m_is_enabled;
+  static bool m_is_script_written;
+};